@@ -22,7 +22,18 @@
 #include <behavior_net/Token.hpp>
 #include <behavior_net/Types.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace capybot
 {
@@ -36,6 +47,7 @@ struct ActionExecutionUnit
     Token::SharedPtr tokenPtr;
     ThreadPool::Task task;
     uint32_t delayedEpochs;
+    std::optional<std::string> concurrencySlot; // key of the per host slot held while in flight, if any
 
     ActionExecutionUnit(Token::SharedPtr const& token, std::function<ActionExecutionStatus()> func, uint32_t delay = 0)
         : tokenPtr(token)
@@ -51,27 +63,171 @@ struct ActionExecutionResult
     ActionExecutionStatus status;
 };
 
+/// @brief result known in advance, to be reported once the deadline is reached
+struct ActionTimedResult
+{
+    TimingWheel::Clock::time_point deadline;
+    ActionExecutionStatus status;
+};
+
 /// @brief  Interface for all implementations
 class IActionImpl
 {
 public:
-    virtual std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) = 0;
+    virtual ~IActionImpl() = default;
+
+    /// @brief create the callable to be executed by the thread pool; called every epoch until the action completes
+    virtual std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token)
+    {
+        throw Exception(ExceptionType::NOT_IMPLEMENTED,
+                        "IActionImpl::createCallable: action type does not support callable execution.");
+    }
+
+    /// @brief [optional] batch execution; if supported, `createBatchCallable` is used instead of `createCallable`
+    virtual bool supportsBatchExecution() const { return false; }
+
+    /// @brief [optional] create a single callable executing all given tokens at once (e.g., one request for many ids).
+    /// It is executed by one thread pool task, and must return one status per token, in the same order.
+    virtual std::function<std::vector<ActionExecutionStatus>()> createBatchCallable(
+        std::vector<Token::ConstSharedPtr> const& tokens)
+    {
+        throw Exception(ExceptionType::NOT_IMPLEMENTED,
+                        "IActionImpl::createBatchCallable: action type does not support batch execution.");
+    }
+
+    /// @brief [optional] timer based execution. If a result is returned, the token is registered once in the thread
+    /// pool timing wheel and resolved when the deadline is reached; no callable is created for it.
+    virtual std::optional<ActionTimedResult> createTimedResult(Token::ConstSharedPtr const& token)
+    {
+        return std::nullopt;
+    }
+
+    /// @brief [optional] called when an execution returns IN_PROGRESS. If a time is returned, the token is not executed
+    /// again before then (e.g., polling hints from a remote agent); otherwise, it is executed again next epoch.
+    virtual std::optional<TimingWheel::Clock::time_point> getNextExecutionTime(Token::ConstSharedPtr const& token)
+    {
+        return std::nullopt;
+    }
+
+    /// @brief [optional] remote resource used by the token execution, e.g., the resolved "<host>:<port>". Executions
+    /// sharing a key are subject to the "max_in_flight_per_host" limit, across all actions of the thread pool.
+    virtual std::optional<std::string> getConcurrencyKey(Token::ConstSharedPtr const& token) { return std::nullopt; }
+
+    /// @brief [optional] the token execution was cancelled (e.g., timeout); running callables for it should return as
+    /// soon as possible, and their result is discarded. Per token state should be cleaned up.
+    virtual void cancel(Token::ConstSharedPtr const& token) {}
+
+    /// @brief [optional] the action is being destroyed: running callables should return as soon as possible (e.g., by
+    /// interrupting blocking calls), and new ones should not block. Destruction waits for running callables to return.
+    virtual void stop() {}
 };
 
-/// @brief Action object to be associated with a place
+/**
+ * @brief Action object to be associated with a place
+ *
+ * Tokens over an in flight limit are not dispatched to the thread pool; they stay in the place and are considered
+ * again next epoch.
+ *
+ * If a token is still not done "timeout_ms" after its execution started (including in progress epochs), it resolves
+ * to "timeout_status" and its execution is cancelled: queued tasks are skipped, and running ones are abandoned after
+ * notifying the implementation. On destruction, all executions are cancelled and the implementation is stopped (see
+ * `IActionImpl::stop`); destruction then waits for running callables, so it takes as long as the slowest of them
+ * needs to return once stopped, e.g., up to its own timeout if it cannot be interrupted.
+ *
+ * Cheap per token callables are grouped into chunks, each executed by a single thread pool task. The chunk size adapts to
+ * the measured callable execution time, so that per task scheduling overhead stays small while all workers are kept
+ * busy; slow callables (e.g., network requests) get a task each.
+ *
+ * Executions completing with a status in "retry_on" are retried up to "max_retries" times before the result is
+ * reported; the token stays busy in the place meanwhile. Retries wait for an exponential backoff starting at
+ * "retry_backoff_ms", or happen next epoch if it is 0. Timeouts apply to all attempts together.
+ *
+ * Deferred tokens (retry backoff, `IActionImpl::getNextExecutionTime`) are resumed when `getEpochResults` collects
+ * their timer, and executed by the following `executeAsync`. Polled in that order, as the controller does, they start
+ * on the first poll at or after their time, i.e., at most one poll period late, like tokens that just arrived.
+ *
+ * Config parameters (common to all action types, next to the implementation ones):
+ *     "max_in_flight"          [uint32_t][default: 0] max executions in flight for this action; 0 for no limit
+ *     "max_in_flight_per_host" [uint32_t][default: 0] max executions in flight per concurrency key (see
+ *                                                     `IActionImpl::getConcurrencyKey`) for all actions; 0 for no limit
+ *     "timeout_ms"             [uint32_t][default: 0] max time for a token execution to complete; 0 for no limit
+ *     "timeout_status"         [string][default: "ERROR"] status of token executions that time out
+ *     "max_retries"            [uint32_t][default: 0] max number of times a token execution is retried
+ *     "retry_on"               [list of strings][default: ["ERROR"]] completed statuses to be retried
+ *     "retry_backoff_ms"       [uint32_t][default: 0] delay before the first retry; doubled for each next one
+ *     "retry_backoff_max_ms"   [uint32_t][default: 10000] retry delay cap
+ */
 class Action
 {
     static constexpr const char* MODULE_TAG{"Action"};
 
+    // chunks should run for at least this long, so that the task overhead (a few us) stays within a few percent
+    static constexpr int64_t CHUNK_TARGET_DURATION_NS{200000};
+
 public:
     using UniquePtr = std::unique_ptr<Action>;
 
-    Action(ThreadPool& tp, std::unique_ptr<IActionImpl>& impl)
+    Action(ThreadPool& tp, std::unique_ptr<IActionImpl>& impl,
+           nlohmann::json const& parameters = nlohmann::json::object())
         : m_threadPool(tp)
+        , m_maxInFlight(parameters.contains("max_in_flight") ? parameters.at("max_in_flight").get<uint32_t>() : 0U)
+        , m_maxInFlightPerHost(parameters.contains("max_in_flight_per_host")
+                                   ? parameters.at("max_in_flight_per_host").get<uint32_t>()
+                                   : 0U)
+        , m_timeout(parameters.contains("timeout_ms") ? parameters.at("timeout_ms").get<uint32_t>() : 0U)
+        , m_timeoutStatus(parseTimeoutStatus(parameters))
+        , m_maxRetries(parameters.contains("max_retries") ? parameters.at("max_retries").get<uint32_t>() : 0U)
+        , m_retryStatuses(parseRetryStatuses(parameters))
+        , m_retryBackoff(parameters.contains("retry_backoff_ms") ? parameters.at("retry_backoff_ms").get<uint32_t>()
+                                                                 : 0U)
+        , m_retryBackoffMax(parameters.contains("retry_backoff_max_ms")
+                                ? parameters.at("retry_backoff_max_ms").get<uint32_t>()
+                                : 10000U)
         , m_actionImpl(std::move(impl))
     {
     }
 
+    ~Action()
+    {
+        // pending timer callbacks reference this object
+        for (auto&& [_, timerId] : m_timedExecutions)
+        {
+            m_threadPool.getTimingWheel().cancel(timerId);
+        }
+        for (auto&& [_, timerId] : m_deferredTokens)
+        {
+            m_threadPool.getTimingWheel().cancel(timerId);
+        }
+        for (auto&& [_, deadline] : m_deadlines)
+        {
+            m_threadPool.getTimingWheel().cancel(deadline.timerId);
+        }
+
+        // queued tasks reference their execution units: skip them, and wait for the running ones
+        for (auto&& units : {&m_epochExecutions, &m_delayedExecutions})
+        {
+            for (auto&& unit : *units)
+            {
+                unit.task.cancel();
+                m_actionImpl->cancel(unit.tokenPtr);
+            }
+        }
+        m_actionImpl->stop(); // also covers abandoned executions and group tasks
+        for (auto&& units : {&m_epochExecutions, &m_delayedExecutions, &m_abandonedExecutions})
+        {
+            for (auto&& unit : *units)
+            {
+                unit.task.cancel();
+                unit.task.wait();
+                releaseConcurrencySlot(unit);
+            }
+        }
+        for (auto&& batchTask : m_groupTasks)
+        {
+            batchTask.wait();
+        }
+    }
+
     void executeAsync(std::list<Token::SharedPtr> const& tokens)
     {
         if (!m_epochExecutions.empty())
@@ -80,13 +236,82 @@ public:
                             "Action::executeAsync: `getEpochResults()` must be called for all 'executeAsync' calls.");
         }
 
+        {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            for (auto&& tokenPtr : m_resumedTokens)
+            {
+                m_deferredTokens.erase(tokenPtr);
+            }
+            m_resumedTokens.clear();
+        }
+
+        std::vector<std::pair<Token::SharedPtr, std::optional<std::string>>> toExecute; // with concurrency slot
+        auto inFlight = m_epochExecutions.size() + m_delayedExecutions.size() + m_abandonedExecutions.size();
         for (auto&& token : tokens)
         {
-            if (isInDelayedExecution(token))
+            if (isInExecution(token))
+                continue;
+
+            if (auto timedResult = m_actionImpl->createTimedResult(token))
+            {
+                startDeadline(token);
+                scheduleTimedResult(token, timedResult.value());
+                continue;
+            }
+
+            if (m_maxInFlight > 0U && inFlight >= m_maxInFlight)
+            {
+                continue;
+            }
+            std::optional<std::string> concurrencySlot;
+            if (m_maxInFlightPerHost > 0U)
+            {
+                concurrencySlot = m_actionImpl->getConcurrencyKey(token);
+                if (concurrencySlot &&
+                    !m_threadPool.getConcurrencyLimiter().tryAcquire(concurrencySlot.value(), m_maxInFlightPerHost))
+                {
+                    continue;
+                }
+            }
+
+            startDeadline(token);
+            toExecute.emplace_back(token, std::move(concurrencySlot));
+            ++inFlight;
+        }
+
+        if (toExecute.empty())
+        {
+            return;
+        }
+        if (m_actionImpl->supportsBatchExecution())
+        {
+            executeBatchAsync(toExecute);
+            return;
+        }
+
+        const auto chunkSize = computeChunkSize(toExecute.size());
+        std::vector<ThreadPool::Task*> chunk;
+        chunk.reserve(chunkSize);
+        for (auto&& [token, concurrencySlot] : toExecute)
+        {
+            m_epochExecutions.emplace_back(token, measuredCallable(m_actionImpl->createCallable(token)));
+            m_epochExecutions.back().concurrencySlot = std::move(concurrencySlot);
+            if (chunkSize == 1U)
+            {
+                m_threadPool.executeAsync(m_epochExecutions.back().task);
                 continue;
+            }
 
-            m_epochExecutions.emplace_back(token, m_actionImpl->createCallable(token));
-            m_threadPool.executeAsync(m_epochExecutions.back().task);
+            chunk.push_back(&m_epochExecutions.back().task);
+            if (chunk.size() == chunkSize)
+            {
+                executeChunkAsync(chunk);
+                chunk.clear();
+            }
+        }
+        if (!chunk.empty())
+        {
+            executeChunkAsync(chunk);
         }
     }
 
@@ -95,6 +320,21 @@ public:
         std::vector<ActionExecutionResult> results;
         results.reserve(m_delayedExecutions.size() + m_epochExecutions.size());
 
+        // timers are driven by the epoch clock: collect everything that expired by now
+        m_threadPool.getTimingWheel().advance(TimingWheel::Clock::now());
+        {
+            std::vector<ActionExecutionResult> expiredTimers;
+            {
+                std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+                expiredTimers.swap(m_expiredTimers);
+            }
+            for (auto&& result : expiredTimers)
+            {
+                m_timedExecutions.erase(result.tokenPtr.get());
+                results.push_back(result);
+            }
+        }
+
         // let's start with the delayed ones
         {
             ActionExecutionUnit::List::iterator it = m_delayedExecutions.begin();
@@ -105,6 +345,8 @@ public:
                     status._value != ActionExecutionStatus::QUERRY_TIMEOUT) // execution is done
                 {
                     results.push_back(ActionExecutionResult{.tokenPtr = it->tokenPtr, .status = status});
+                    releaseConcurrencySlot(*it);
+                    m_delayedTokens.erase(it->tokenPtr.get());
                     m_delayedExecutions.erase(it++);
                 }
                 else
@@ -125,34 +367,434 @@ public:
                     status._value != ActionExecutionStatus::QUERRY_TIMEOUT) // execution is done
                 {
                     results.push_back(ActionExecutionResult{.tokenPtr = unit.tokenPtr, .status = status});
+                    releaseConcurrencySlot(unit);
                     m_epochExecutions.pop_front();
                 }
                 else
                 {
                     // move first element to delayed executionslist
                     ++unit.delayedEpochs;
+                    m_delayedTokens.insert(unit.tokenPtr.get());
                     m_delayedExecutions.splice(m_delayedExecutions.end(), m_epochExecutions, m_epochExecutions.begin());
                 }
             }
         }
 
+        m_groupTasks.remove_if([](ThreadPool::Task const& task) {
+            const auto status = task.getStatus();
+            return status._value != ActionExecutionStatus::NOT_STARTED &&
+                   status._value != ActionExecutionStatus::QUERRY_TIMEOUT;
+        });
+
+        // cancelled executions that are still running are only kept until they return
+        m_abandonedExecutions.remove_if([this](ActionExecutionUnit const& unit) {
+            const auto status = unit.task.getStatus();
+            if (status._value == ActionExecutionStatus::NOT_STARTED ||
+                status._value == ActionExecutionStatus::QUERRY_TIMEOUT)
+            {
+                return false;
+            }
+            releaseConcurrencySlot(unit);
+            return true;
+        });
+
+        if (m_maxRetries > 0U)
+        {
+            applyRetryPolicy(results);
+        }
+        if (m_timeout > 0U)
+        {
+            applyTimeouts(results);
+        }
+
+        // in progress actions might not need to be executed again right away
+        for (auto&& result : results)
+        {
+            if (result.status == +ActionExecutionStatus::IN_PROGRESS)
+            {
+                if (auto nextExecutionTime = m_actionImpl->getNextExecutionTime(result.tokenPtr))
+                {
+                    deferExecution(result.tokenPtr, nextExecutionTime.value());
+                }
+            }
+        }
+
         return results;
     }
 
-    uint32_t getNumberDelayedTasks() const { return m_delayedExecutions.size(); }
+    uint32_t getNumberDelayedTasks() const
+    {
+        return m_delayedExecutions.size() + m_timedExecutions.size() + m_deferredTokens.size();
+    }
+
+    /// @brief parse a completed status (SUCCESS, FAILURE, or ERROR) from the parameter `key`
+    static ActionExecutionStatus parseCompletedStatus(std::string const& key, std::string const& statusStr)
+    {
+        const auto status = ActionExecutionStatus::_from_string_nothrow(statusStr.c_str());
+        if (!status || (status.value() != +ActionExecutionStatus::SUCCESS &&
+                        status.value() != +ActionExecutionStatus::FAILURE &&
+                        status.value() != +ActionExecutionStatus::ERROR))
+        {
+            throw Exception(ExceptionType::INVALID_CONFIG_FILE, "Action: invalid status parameter.")
+                .appendMetadata(key, statusStr);
+        }
+        return status.value();
+    }
+
+    /// @brief cancel the token execution, if any, e.g., when the token is removed from the place; no result is reported
+    void cancel(Token::SharedPtr const& token)
+    {
+        cancelExecution(token);
+        {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            std::erase_if(m_expiredTimers, [&token](auto const& result) { return result.tokenPtr == token; });
+            std::erase(m_timedOutTokens, token.get());
+        }
+        if (const auto it = m_deadlines.find(token.get()); it != m_deadlines.end())
+        {
+            m_threadPool.getTimingWheel().cancel(it->second.timerId);
+            m_deadlines.erase(it);
+        }
+    }
+
+    /// @brief tokens per thread pool task: enough work to amortize the task overhead, but at most an even share of the
+    /// tokens per worker. Until callables are measured, each token gets its own task.
+    std::size_t computeChunkSize(std::size_t numberTokens) const
+    {
+        const auto average = m_callableExecutionTimeNs.load(std::memory_order_relaxed);
+        if (average <= 0 || numberTokens < 2U)
+        {
+            return 1U;
+        }
+        const std::size_t amortized = (CHUNK_TARGET_DURATION_NS + average - 1) / average;
+        const std::size_t workers = std::max<std::size_t>(m_threadPool.getNumberWorkers(), 1U);
+        const std::size_t evenShare = (numberTokens + workers - 1U) / workers;
+        return std::clamp<std::size_t>(std::min(amortized, evenShare), 1U, numberTokens);
+    }
 
 private:
-    bool isInDelayedExecution(Token::ConstSharedPtr const& tokenPtr) const
+    struct Deadline
+    {
+        Token::SharedPtr tokenPtr;
+        TimingWheel::TimerId timerId;
+    };
+
+    static ActionExecutionStatus parseTimeoutStatus(nlohmann::json const& parameters)
+    {
+        return parameters.contains("timeout_status")
+                   ? parseCompletedStatus("timeout_status", parameters.at("timeout_status").get<std::string>())
+                   : +ActionExecutionStatus::ERROR;
+    }
+
+    static ActionExecutionStatusSet parseRetryStatuses(nlohmann::json const& parameters)
+    {
+        ActionExecutionStatusSet statuses{};
+        if (!parameters.contains("retry_on"))
+        {
+            statuses.set(ActionExecutionStatus::ERROR);
+            return statuses;
+        }
+        for (auto&& statusStr : parameters.at("retry_on"))
+        {
+            statuses.set(parseCompletedStatus("retry_on", statusStr.get<std::string>()));
+        }
+        return statuses;
+    }
+
+    /// @brief hold back completed results that should be retried, and schedule their retry
+    void applyRetryPolicy(std::vector<ActionExecutionResult>& results)
+    {
+        std::erase_if(results, [this](ActionExecutionResult const& result) {
+            if (result.status == +ActionExecutionStatus::IN_PROGRESS)
+            {
+                return false;
+            }
+
+            const auto retriesIt = m_retries.find(result.tokenPtr.get());
+            const uint32_t retries = retriesIt != m_retries.end() ? retriesIt->second : 0U;
+            if (!m_retryStatuses.test(result.status) || retries >= m_maxRetries)
+            {
+                if (retriesIt != m_retries.end())
+                {
+                    m_retries.erase(retriesIt);
+                }
+                return false;
+            }
+            m_retries[result.tokenPtr.get()] = retries + 1U;
+
+            auto backoff = std::chrono::milliseconds(0);
+            if (m_retryBackoff.count() > 0)
+            {
+                backoff = m_retryBackoff;
+                for (uint32_t i = 0U; i < retries && backoff < m_retryBackoffMax; ++i)
+                {
+                    backoff *= 2;
+                }
+                backoff = std::min(backoff, m_retryBackoffMax);
+                deferExecution(result.tokenPtr, TimingWheel::Clock::now() + backoff);
+            }
+            LOG(INFO) << "retrying execution with status " << result.status._to_string() << " (retry " << retries + 1U
+                      << "/" << m_maxRetries << ") in " << backoff.count() << " ms" << log::endl;
+            return true;
+        });
+    }
+
+    /// @brief start the token timeout, unless it is already running (e.g., in progress execution)
+    void startDeadline(Token::SharedPtr const& token)
+    {
+        if (m_timeout == 0U || m_deadlines.contains(token.get()))
+        {
+            return;
+        }
+        const auto onExpiry = [this, tokenPtr = token.get()] {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            m_timedOutTokens.push_back(tokenPtr);
+        };
+        const auto timerId = m_threadPool.getTimingWheel().schedule(
+            TimingWheel::Clock::now() + std::chrono::milliseconds(m_timeout), onExpiry);
+        m_deadlines.emplace(token.get(), Deadline{.tokenPtr = token, .timerId = timerId});
+    }
+
+    /// @brief resolve timed out tokens to `m_timeoutStatus`, and drop the deadlines of completed ones
+    void applyTimeouts(std::vector<ActionExecutionResult>& results)
+    {
+        std::vector<Token const*> timedOut;
+        {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            timedOut.swap(m_timedOutTokens);
+        }
+
+        for (auto&& tokenPtr : timedOut)
+        {
+            const auto deadlineIt = m_deadlines.find(tokenPtr);
+            if (deadlineIt == m_deadlines.end())
+            {
+                continue;
+            }
+            const auto token = deadlineIt->second.tokenPtr;
+            m_deadlines.erase(deadlineIt);
+
+            auto resultIt = std::find_if(results.begin(), results.end(),
+                                         [&token](auto const& result) { return result.tokenPtr == token; });
+            if (resultIt != results.end())
+            {
+                if (resultIt->status != +ActionExecutionStatus::IN_PROGRESS) // completed just in time
+                {
+                    continue;
+                }
+                resultIt->status = m_timeoutStatus;
+            }
+            else
+            {
+                results.push_back(ActionExecutionResult{.tokenPtr = token, .status = m_timeoutStatus});
+            }
+            LOG(INFO) << "token execution timed out after " << m_timeout << " ms; resolving it to "
+                      << m_timeoutStatus._to_string() << log::endl;
+            cancelExecution(token);
+        }
+
+        for (auto&& result : results)
+        {
+            if (result.status == +ActionExecutionStatus::IN_PROGRESS)
+            {
+                continue;
+            }
+            if (const auto it = m_deadlines.find(result.tokenPtr.get()); it != m_deadlines.end())
+            {
+                m_threadPool.getTimingWheel().cancel(it->second.timerId);
+                m_deadlines.erase(it);
+            }
+        }
+    }
+
+    /// @brief stop tracking all executions of the token; running tasks are abandoned
+    void cancelExecution(Token::SharedPtr const& token)
+    {
+        auto& timingWheel = m_threadPool.getTimingWheel();
+        if (const auto it = m_timedExecutions.find(token.get()); it != m_timedExecutions.end())
+        {
+            timingWheel.cancel(it->second);
+            m_timedExecutions.erase(it);
+        }
+        if (const auto it = m_deferredTokens.find(token.get()); it != m_deferredTokens.end())
+        {
+            timingWheel.cancel(it->second);
+            m_deferredTokens.erase(it);
+        }
+
+        m_delayedTokens.erase(token.get());
+        for (auto&& units : {&m_epochExecutions, &m_delayedExecutions})
+        {
+            const auto it = std::find_if(units->begin(), units->end(),
+                                         [&token](auto const& unit) { return unit.tokenPtr == token; });
+            if (it != units->end())
+            {
+                it->task.cancel();
+                m_abandonedExecutions.splice(m_abandonedExecutions.end(), *units, it);
+            }
+        }
+
+        m_retries.erase(token.get());
+        m_actionImpl->cancel(token);
+    }
+
+    bool isInExecution(Token::ConstSharedPtr const& tokenPtr) const
+    {
+        return m_delayedTokens.contains(tokenPtr.get()) || m_timedExecutions.contains(tokenPtr.get()) ||
+               m_deferredTokens.contains(tokenPtr.get());
+    }
+
+    /// @brief execute all tokens with a single batch callable. Each token still gets its execution unit, whose task
+    /// only reports the token status and is executed by the batch task, so results are handled as usual.
+    void executeBatchAsync(std::vector<std::pair<Token::SharedPtr, std::optional<std::string>>>& toExecute)
     {
-        const auto checkPtr = [&tokenPtr](const ActionExecutionUnit& unit) { return unit.tokenPtr == tokenPtr; };
-        return std::find_if(m_delayedExecutions.begin(), m_delayedExecutions.end(), checkPtr) !=
-               m_delayedExecutions.end();
+        std::vector<Token::ConstSharedPtr> batchTokens;
+        batchTokens.reserve(toExecute.size());
+        for (auto&& [token, _] : toExecute)
+        {
+            batchTokens.push_back(token);
+        }
+        auto batchCallable = m_actionImpl->createBatchCallable(batchTokens);
+
+        auto statuses = std::make_shared<std::vector<ActionExecutionStatus>>();
+        std::vector<ThreadPool::Task*> unitTasks;
+        unitTasks.reserve(toExecute.size());
+        for (std::size_t i = 0U; i < toExecute.size(); ++i)
+        {
+            m_epochExecutions.emplace_back(toExecute[i].first, [statuses, i]() { return statuses->at(i); });
+            m_epochExecutions.back().concurrencySlot = std::move(toExecute[i].second);
+            unitTasks.push_back(&m_epochExecutions.back().task);
+        }
+
+        m_groupTasks.emplace_back(
+            [batchCallable, statuses, unitTasks]() -> ActionExecutionStatus {
+                const bool allCancelled = std::all_of(unitTasks.begin(), unitTasks.end(),
+                                                      [](auto const* task) { return task->isCancelled(); });
+                if (!allCancelled)
+                {
+                    try
+                    {
+                        *statuses = batchCallable();
+                    }
+                    catch (std::exception& e)
+                    {
+                        LOG(ERROR) << "batch callable threw; tokens resolve to ERROR. error = " << e.what()
+                                   << log::endl;
+                    }
+                    if (statuses->size() != unitTasks.size())
+                    {
+                        LOG(ERROR) << "batch callable returned " << statuses->size() << " statuses for "
+                                   << unitTasks.size() << " tokens; tokens without status resolve to ERROR"
+                                   << log::endl;
+                    }
+                }
+                for (auto* task : unitTasks) // unit tasks that were cancelled meanwhile are skipped
+                {
+                    task->executeSync();
+                }
+                return ActionExecutionStatus::SUCCESS;
+            },
+            [unitTasks]() { skipTasks(unitTasks); });
+        m_threadPool.executeAsync(m_groupTasks.back());
+    }
+
+    /// @brief mark the unit tasks of a skipped group task as done, so that they are not waited for forever
+    static void skipTasks(std::vector<ThreadPool::Task*> const& unitTasks)
+    {
+        for (auto* task : unitTasks)
+        {
+            task->cancel();
+            task->executeSync();
+        }
+    }
+
+    /// @brief wrap `callable` to keep track of the average callable execution time
+    std::function<ActionExecutionStatus()> measuredCallable(std::function<ActionExecutionStatus()> callable)
+    {
+        return [this, callable = std::move(callable)]() {
+            const auto start = std::chrono::steady_clock::now();
+            const auto status = callable();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const int64_t sample = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            // exponential moving average; concurrent updates may be lost, which is fine for an estimate
+            const auto average = m_callableExecutionTimeNs.load(std::memory_order_relaxed);
+            m_callableExecutionTimeNs.store(average > 0 ? (7 * average + sample) / 8 : std::max<int64_t>(sample, 1),
+                                            std::memory_order_relaxed);
+            return status;
+        };
+    }
+
+    void executeChunkAsync(std::vector<ThreadPool::Task*> const& unitTasks)
+    {
+        m_groupTasks.emplace_back(
+            [unitTasks]() -> ActionExecutionStatus {
+                for (auto* task : unitTasks) // unit tasks that were cancelled meanwhile are skipped
+                {
+                    task->executeSync();
+                }
+                return ActionExecutionStatus::SUCCESS;
+            },
+            [unitTasks]() { skipTasks(unitTasks); });
+        m_threadPool.executeAsync(m_groupTasks.back());
+    }
+
+    void releaseConcurrencySlot(ActionExecutionUnit const& unit)
+    {
+        if (unit.concurrencySlot)
+        {
+            m_threadPool.getConcurrencyLimiter().release(unit.concurrencySlot.value());
+        }
+    }
+
+    /// @brief skip the token until the first `getEpochResults` at or after `until`; the next `executeAsync` runs it
+    void deferExecution(Token::SharedPtr const& token, TimingWheel::Clock::time_point until)
+    {
+        const auto onExpiry = [this, tokenPtr = token.get()] {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            m_resumedTokens.push_back(tokenPtr);
+        };
+        m_deferredTokens.emplace(token.get(), m_threadPool.getTimingWheel().schedule(until, onExpiry));
+    }
+
+    void scheduleTimedResult(Token::SharedPtr const& token, ActionTimedResult const& timedResult)
+    {
+        const auto onExpiry = [this, token, status = timedResult.status] {
+            std::lock_guard<std::mutex> lk(m_timerCallbacksMtx);
+            m_expiredTimers.push_back(ActionExecutionResult{.tokenPtr = token, .status = status});
+        };
+        m_timedExecutions.emplace(token.get(), m_threadPool.getTimingWheel().schedule(timedResult.deadline, onExpiry));
     }
 
     ActionExecutionUnit::List m_epochExecutions{};
     ActionExecutionUnit::List m_delayedExecutions{};
+    std::list<ThreadPool::Task> m_groupTasks{}; // run unit tasks of several tokens (batches, chunks); kept until done
+    std::atomic<int64_t> m_callableExecutionTimeNs{0}; // average; 0 until measured
+    std::unordered_set<Token const*> m_delayedTokens{}; // tokens in `m_delayedExecutions`, for fast lookup
     ThreadPool& m_threadPool;
 
+    const uint32_t m_maxInFlight;        // 0 for no limit
+    const uint32_t m_maxInFlightPerHost; // 0 for no limit
+
+    const uint32_t m_timeout; // [ms] 0 for no limit
+    const ActionExecutionStatus m_timeoutStatus;
+    std::unordered_map<Token const*, Deadline> m_deadlines{}; // only for tokens in execution, if timeout is enabled
+    ActionExecutionUnit::List m_abandonedExecutions{};        // cancelled while running; kept until they return
+
+    const uint32_t m_maxRetries; // 0 if retrying is disabled
+    const ActionExecutionStatusSet m_retryStatuses;
+    const std::chrono::milliseconds m_retryBackoff; // 0 for retrying next epoch
+    const std::chrono::milliseconds m_retryBackoffMax;
+    std::unordered_map<Token const*, uint32_t> m_retries{}; // retries so far of tokens in execution
+
+    std::unordered_map<Token const*, TimingWheel::TimerId> m_timedExecutions{}; // see `createTimedResult`
+    std::unordered_map<Token const*, TimingWheel::TimerId> m_deferredTokens{};  // see `getNextExecutionTime`
+
+    // filled by timing wheel callbacks
+    std::vector<ActionExecutionResult> m_expiredTimers{};
+    std::vector<Token const*> m_resumedTokens{};
+    std::vector<Token const*> m_timedOutTokens{};
+    std::mutex m_timerCallbacksMtx;
+
     std::unique_ptr<IActionImpl> m_actionImpl{};
 };
 
@@ -16,6 +16,9 @@
  */
 
 #include <behavior_net/ActionRegistry.hpp>
+#include <utils/Logger.hpp>
+
+#include <dlfcn.h>
 
 namespace capybot
 {
@@ -24,5 +27,53 @@ namespace bnet
 
 ActionRegistry ActionRegistry::s_registry;
 
+void ActionRegistry::loadPlugin(std::string const& path)
+{
+    if (s_registry.m_loadedPlugins.contains(path))
+    {
+        return;
+    }
+
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "ActionRegistry::loadPlugin: failed to load action plugin.")
+            .appendMetadata("path", path)
+            .appendMetadata("error", std::string(dlerror()));
+    }
+
+    using RegisterFunction = void (*)(PluginRegistrar const&);
+    auto registerFunc = reinterpret_cast<RegisterFunction>(dlsym(handle, BNET_ACTION_PLUGIN_SYMBOL));
+    if (!registerFunc)
+    {
+        dlclose(handle);
+        throw Exception(ExceptionType::RUNTIME_ERROR,
+                        "ActionRegistry::loadPlugin: action plugin does not define the registration symbol.")
+            .appendMetadata("path", path)
+            .appendMetadata("symbol", std::string(BNET_ACTION_PLUGIN_SYMBOL));
+    }
+
+    std::vector<std::string> duplicatedTypes{};
+    registerFunc([&duplicatedTypes](ActionCreateFunction const& createFunc, std::string const& id) {
+        if (registerActionType(createFunc, id))
+        {
+            LOG(INFO) << "registered plugin action type " << id << log::endl;
+        }
+        else
+        {
+            duplicatedTypes.push_back(id);
+        }
+    });
+    s_registry.m_loadedPlugins.insert(path);
+
+    if (!duplicatedTypes.empty())
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR,
+                        "ActionRegistry::loadPlugin: action plugin registers types that already exist.")
+            .appendMetadata("path", path)
+            .appendMetadata("duplicated types", duplicatedTypes);
+    }
+}
+
 } // namespace bnet
 } // namespace capybot
@@ -20,20 +20,41 @@
 #include <behavior_net/Action.hpp>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #define REGISTER_ACTION_TYPE(actionType)                                                                               \
     static bool _registered_##actionType = ActionRegistry::registerActionType(                                         \
         [](nlohmann::json const parameters) { return std::unique_ptr<IActionImpl>(new actionType(parameters)); },      \
         #actionType);
 
+/// @brief symbol looked up in action plugins, see `ActionRegistry::loadPlugin`
+#define BNET_ACTION_PLUGIN_SYMBOL "bnet_register_action_plugin"
+
+/// @brief plugin counterpart of REGISTER_ACTION_TYPE, to be used once per shared library. For registering several
+/// action types, define `bnet_register_action_plugin` and call the registrar once per type instead.
+#define REGISTER_ACTION_PLUGIN(actionType)                                                                             \
+    extern "C" __attribute__((visibility("default"))) void bnet_register_action_plugin(                               \
+        capybot::bnet::ActionRegistry::PluginRegistrar const& registrar)                                               \
+    {                                                                                                                  \
+        registrar(                                                                                                     \
+            [](nlohmann::json const parameters) {                                                                      \
+                return std::unique_ptr<capybot::bnet::IActionImpl>(new actionType(parameters));                        \
+            },                                                                                                         \
+            #actionType);                                                                                              \
+    }
+
 namespace capybot
 {
 namespace bnet
 {
 class ActionRegistry
 {
+    static constexpr const char* MODULE_TAG{"ActionRegistry"};
+
 public:
     using ActionCreateFunction = std::function<std::unique_ptr<IActionImpl>(nlohmann::json const parameters)>;
+    using PluginRegistrar = std::function<void(ActionCreateFunction const& createFunc, std::string const& id)>;
 
     static bool registerActionType(ActionCreateFunction const& createFunc, std::string const& id)
     {
@@ -41,6 +62,17 @@ public:
         return success;
     }
 
+    /**
+     * @brief Load a shared library registering action types, see REGISTER_ACTION_PLUGIN. Loading the same path again
+     * has no effect.
+     *
+     * Plugins implement IActionImpl, so they must be built with the same toolchain and behavior_net headers. They must
+     * not link behavior_net_lib themselves: their references resolve to the host process, which must export its
+     * symbols (`-rdynamic`). They are never unloaded, since action implementations may be alive until the process
+     * exits.
+     */
+    static void loadPlugin(std::string const& path);
+
     static Action::UniquePtr create(ThreadPool& tp, std::string const& actionType, nlohmann::json const& parameters)
     {
         if (s_registry.m_createFunctionMap.find(actionType) == s_registry.m_createFunctionMap.end())
@@ -57,7 +89,7 @@ public:
         }
 
         auto actionImpl = s_registry.m_createFunctionMap.at(actionType)(parameters);
-        return std::make_unique<Action>(tp, actionImpl);
+        return std::make_unique<Action>(tp, actionImpl, parameters);
     }
 
     // static std::map<std::string, Action::UniquePtr> createActionMap(ThreadPool& tp, nlohmann::json const
@@ -74,6 +106,7 @@ public:
 private:
     static ActionRegistry s_registry;
     std::map<std::string, ActionCreateFunction> m_createFunctionMap;
+    std::set<std::string> m_loadedPlugins;
 };
 
 } // namespace bnet
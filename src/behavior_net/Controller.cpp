@@ -19,32 +19,338 @@
 #include <behavior_net/Types.hpp>
 #include <utils/Logger.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <set>
+
 namespace capybot
 {
 namespace bnet
 {
 
+namespace
+{
+Token::UniquePtr makeToken(nlohmann::json&& contentBlocks, std::optional<std::chrono::milliseconds> ttl)
+{
+    auto token = Token::makeUnique();
+    for (auto&& [key, block] : contentBlocks.items())
+    {
+        token->addContentBlock(key, std::move(block));
+    }
+    if (ttl.has_value())
+    {
+        token->setExpiry(Token::Clock::now() + ttl.value());
+    }
+    return token;
+}
+
+template <typename FuncT>
+std::optional<std::string> tryApply(FuncT&& func)
+{
+    try
+    {
+        func();
+    }
+    catch (std::exception const& e)
+    {
+        return std::string(e.what());
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief SAX handler of `/add_token` payloads. "content_blocks" is built in place in the request by a DOM parser the
+ * events are forwarded to; the other members are read without building json values; unknown members are skipped.
+ */
+class TokenRequestSax
+{
+    using json = nlohmann::json;
+
+public:
+    explicit TokenRequestSax(TokenRequest& request)
+        : m_request(request)
+    {
+    }
+
+    bool null() { return m_blocks ? m_blocks->null() : memberValue(); }
+    bool boolean(bool val) { return m_blocks ? m_blocks->boolean(val) : memberValue(); }
+    bool number_integer(json::number_integer_t val) { return m_blocks ? m_blocks->number_integer(val) : memberValue(); }
+    bool number_float(json::number_float_t val, json::string_t const& s)
+    {
+        return m_blocks ? m_blocks->number_float(val, s) : memberValue();
+    }
+    bool binary(json::binary_t& val) { return m_blocks ? m_blocks->binary(val) : memberValue(); }
+
+    bool number_unsigned(json::number_unsigned_t val)
+    {
+        if (m_blocks)
+        {
+            return m_blocks->number_unsigned(val);
+        }
+        if (isMember("ttl_ms") && val <= std::numeric_limits<uint32_t>::max())
+        {
+            m_request.ttl = std::chrono::milliseconds(val);
+            return true;
+        }
+        return memberValue();
+    }
+
+    bool string(json::string_t& val)
+    {
+        if (m_blocks)
+        {
+            return m_blocks->string(val);
+        }
+        if (isMember("place_id"))
+        {
+            m_request.placeId = std::move(val);
+            m_hasPlaceId = true;
+            return true;
+        }
+        return memberValue();
+    }
+
+    bool key(json::string_t& val)
+    {
+        if (m_blocks)
+        {
+            return m_blocks->key(val);
+        }
+        if (m_depth == 1U)
+        {
+            m_key = std::move(val);
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t elements)
+    {
+        if (!m_blocks && isMember("content_blocks"))
+        {
+            m_request.contentBlocks = json();
+            m_blocks.emplace(m_request.contentBlocks);
+        }
+        if (m_blocks)
+        {
+            ++m_blocksDepth;
+            return m_blocks->start_object(elements);
+        }
+        if (m_depth > 0U)
+        {
+            memberValue();
+        }
+        ++m_depth;
+        return true;
+    }
+
+    bool end_object()
+    {
+        if (m_blocks)
+        {
+            const bool ok = m_blocks->end_object();
+            if (--m_blocksDepth == 0U)
+            {
+                m_blocks.reset();
+                m_hasContentBlocks = true;
+            }
+            return ok;
+        }
+        --m_depth;
+        return true;
+    }
+
+    bool start_array(std::size_t elements)
+    {
+        if (m_blocks)
+        {
+            ++m_blocksDepth;
+            return m_blocks->start_array(elements);
+        }
+        memberValue();
+        ++m_depth;
+        return true;
+    }
+
+    bool end_array()
+    {
+        if (m_blocks)
+        {
+            --m_blocksDepth;
+            return m_blocks->end_array();
+        }
+        --m_depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t /*position*/, std::string const& /*lastToken*/, nlohmann::detail::exception const& ex)
+    {
+        throw Exception(ExceptionType::INVALID_VALUE, "TokenRequest::parse: invalid json.")
+            .appendMetadata("error", ex.what());
+    }
+
+    /// @throw INVALID_VALUE if a required member is missing
+    void checkComplete() const
+    {
+        if (!m_hasPlaceId || !m_hasContentBlocks)
+        {
+            throw Exception(ExceptionType::INVALID_VALUE,
+                            "TokenRequest::parse: `place_id` and `content_blocks` are required.");
+        }
+    }
+
+private:
+    bool isMember(std::string_view key) const { return m_depth == 1U && m_key == key; }
+
+    /// @brief a value not handled above: skipped, unless it is the payload itself or has a known key
+    /// @throw INVALID_VALUE if the value has the wrong type
+    bool memberValue() const
+    {
+        if (m_depth == 0U)
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "TokenRequest::parse: expected an object.");
+        }
+        if (isMember("place_id") || isMember("content_blocks") || isMember("ttl_ms"))
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "TokenRequest::parse: invalid member type.")
+                .appendMetadata("key", m_key);
+        }
+        return true;
+    }
+
+    TokenRequest& m_request;
+    std::size_t m_depth{0U}; // of the skipped values, or 1 within the payload object
+    std::string m_key;       // last key of the payload object
+    bool m_hasPlaceId{false};
+    bool m_hasContentBlocks{false};
+
+    std::optional<nlohmann::detail::json_sax_dom_parser<json>> m_blocks; // while within "content_blocks"
+    std::size_t m_blocksDepth{0U};
+};
+} // namespace
+
+TokenRequest TokenRequest::parse(std::string_view payload)
+{
+    TokenRequest request;
+    TokenRequestSax sax(request);
+    nlohmann::json::sax_parse(payload, &sax);
+    sax.checkComplete();
+    return request;
+}
+
 Controller::Controller(NetConfig const& config, std::unique_ptr<PetriNet> petriNet)
     : m_tp(config.get().at("controller").at("thread_poll_workers").get<uint32_t>())
     , m_config(config.get().at("controller"))
     , m_net(std::move(petriNet))
-    , m_server(IServer::create(config.get().at("controller"), createCallbacks()))
+    , m_servers(IServer::create(config.get().at("controller"), createCallbacks()))
 {
+    if (m_config.contains("action_plugins"))
+    {
+        for (auto&& pluginPath : m_config.at("action_plugins"))
+        {
+            ActionRegistry::loadPlugin(pluginPath.get<std::string>());
+        }
+    }
     Place::Factory::createActions(m_tp, config.get().at("controller").at("actions"), m_net->getPlaces());
+
+    const std::chrono::milliseconds epochPeriod(m_config.at("epoch_period_ms").get<uint32_t>());
+    m_highPriorityPeriod = m_config.contains("high_priority_period_ms")
+                               ? std::chrono::milliseconds(m_config.at("high_priority_period_ms").get<uint32_t>())
+                               : epochPeriod;
+    if (m_highPriorityPeriod.count() == 0)
+    {
+        throw Exception(ExceptionType::INVALID_CONFIG_FILE, "Invalid `high_priority_period_ms` (expected > 0).");
+    }
+
+    std::set<Place const*> highPriorityPlaces;
+    for (auto&& t : m_net->getTransitions())
+    {
+        if (t.isManual())
+        {
+            continue;
+        }
+        if (t.getPriority() == +TransitionPriority::HIGH)
+        {
+            m_highPriorityLane.push_back(&t);
+            for (auto&& arc : t.getInputArcs())
+            {
+                highPriorityPlaces.insert(arc.place.get());
+            }
+        }
+        else
+        {
+            m_normalPriorityLane.push_back(&t);
+        }
+    }
+
+    for (auto&& [_, place] : m_net->getPlaces())
+    {
+        if (!place->isPassive())
+        {
+            const auto defaultPeriod = highPriorityPlaces.contains(place.get()) ? m_highPriorityPeriod : epochPeriod;
+            m_pollSchedules.push_back({place, place->getPollPeriod().value_or(defaultPeriod), Clock::now()});
+        }
+    }
+    m_nextEpoch = Clock::now();
+
+    publishMarkingChanges();
 }
 
-void Controller::addToken(nlohmann::json const& contentBlocks, std::string_view placeId)
+void Controller::addToken(nlohmann::json contentBlocks, std::string_view placeId,
+                          std::optional<std::chrono::milliseconds> ttl)
 {
-    LOG(DEBUG) << "addToken @ " << placeId << "; content = " << contentBlocks << log::endl;
+    // not the content: log messages are formatted whatever the log level, and blocks can be large
+    LOG(DEBUG) << "addToken @ " << placeId << "; " << contentBlocks.size() << " content blocks" << log::endl;
 
-    auto token = Token::makeUnique();
-    for (nlohmann::json::const_iterator it = contentBlocks.begin(); it != contentBlocks.end(); ++it)
+    auto token = makeToken(std::move(contentBlocks), ttl);
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    m_net->addToken(token, placeId);
+
+    m_net->prettyPrintState();
+}
+
+BulkResults Controller::addTokens(std::vector<TokenRequest> requests)
+{
+    LOG(DEBUG) << "addTokens: " << requests.size() << " tokens" << log::endl;
+
+    BulkResults results;
+    results.reserve(requests.size());
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    for (auto&& request : requests)
     {
-        token->addContentBlock(it.key(), it.value());
+        results.push_back(tryApply([&] {
+            auto token = makeToken(std::move(request.contentBlocks), request.ttl);
+            m_net->addToken(token, request.placeId);
+        }));
     }
-    m_net->addToken(token, placeId);
 
     m_net->prettyPrintState();
+    return results;
+}
+
+nlohmann::json Controller::getMarking(std::optional<uint64_t> sinceVersion)
+{
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    return m_net->getMarking(sinceVersion);
+}
+
+void Controller::triggerManualTransition(std::string_view id)
+{
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    m_net->triggerTransition(id, true);
+}
+
+BulkResults Controller::triggerManualTransitions(std::vector<std::string> const& ids)
+{
+    LOG(DEBUG) << "triggerManualTransitions: " << ids.size() << " transitions" << log::endl;
+
+    BulkResults results;
+    results.reserve(ids.size());
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    for (auto&& id : ids)
+    {
+        results.push_back(tryApply([&] { m_net->triggerTransition(id, true); }));
+    }
+    return results;
 }
 
 void Controller::run()
@@ -59,9 +365,9 @@ void Controller::run()
     LOG(INFO) << "run: running... " << log::endl;
 
     m_running.store(true);
-    if (m_server)
+    for (auto&& server : m_servers)
     {
-        m_server->start();
+        server->start();
     }
     while (m_running.load())
     {
@@ -84,9 +390,9 @@ void Controller::stop()
     SCOPED_LOG_TRACER("stop");
 
     m_running.store(false);
-    if (m_server)
+    for (auto&& server : m_servers)
     {
-        m_server->stop();
+        server->stop();
     }
     if (m_runDetachedThread.joinable())
     {
@@ -98,45 +404,143 @@ void Controller::runEpoch()
 {
     SCOPED_LOG_TRACER("runEpoch");
 
-    const uint32_t periodMs = m_config.at("epoch_period_ms").get<uint32_t>();
+    const std::chrono::milliseconds epochPeriod(m_config.at("epoch_period_ms").get<uint32_t>());
+    std::unique_lock<std::mutex> lk(m_netMtx);
+    const auto now = Clock::now();
+    const bool isEpochDue = m_nextEpoch <= now;
 
-    // execute all actions
-    for (auto&& [_, place] : m_net->getPlaces())
+    std::vector<PollSchedule*> duePlaces;
+    for (auto&& schedule : m_pollSchedules)
     {
-        place->executeActionAsync();
+        if (schedule.nextPoll <= now)
+        {
+            duePlaces.push_back(&schedule);
+        }
     }
 
-    // wait
-    std::this_thread::sleep_for(std::chrono::milliseconds(periodMs)); // TODO: sleep until
+    // collect results of the executions started on the previous poll
+    for (auto&& schedule : duePlaces)
+    {
+        schedule->place->checkActionResults();
+    }
 
-    // wait for tasks to complete
-    for (auto&& [_, place] : m_net->getPlaces())
+    m_net->expireTokens();
+
+    // the normal lane also fires as soon as its inputs may have changed, e.g., results of fast polled places, expired
+    // or added tokens; otherwise at least once per epoch
+    fireTransitions(m_highPriorityLane);
+    if (isEpochDue || !duePlaces.empty() || m_net->getMarkingVersion() != m_normalLaneVersion)
+    {
+        fireTransitions(m_normalPriorityLane);
+        m_normalLaneVersion = m_net->getMarkingVersion();
+    }
+    if (isEpochDue)
     {
-        place->checkActionResults();
+        m_nextEpoch += epochPeriod;
+        if (m_nextEpoch <= now)
+        {
+            m_nextEpoch = now + epochPeriod;
+        }
     }
 
-    // fire all enabled auto transitions
-    for (auto&& t : m_net->getTransitions())
+    // execute actions on due places, including tokens just produced by the transitions
+    for (auto&& schedule : duePlaces)
     {
-        if (t.isManual())
-            continue;
+        schedule->place->executeActionAsync();
+        schedule->nextPoll += schedule->period;
+        if (schedule->nextPoll <= now)
+        {
+            schedule->nextPoll = now + schedule->period; // overrun: skip missed polls instead of bursting
+        }
+    }
+
+    publishMarkingChanges();
+    lk.unlock();
+
+    // wait
+    auto wakeUp = m_nextEpoch;
+    if (!m_highPriorityLane.empty())
+    {
+        wakeUp = std::min(wakeUp, now + m_highPriorityPeriod);
+    }
+    for (auto&& schedule : m_pollSchedules)
+    {
+        wakeUp = std::min(wakeUp, schedule.nextPoll);
+    }
+    std::this_thread::sleep_until(wakeUp);
+}
 
+void Controller::fireTransitions(std::vector<Transition*> const& lane)
+{
+    for (auto&& t : lane)
+    {
         // current logic is to trigger a transition only once per epoch
         // TODO: this should be configurable as this logic does not fulfill all use cases
-        if (t.isEnabled())
+        if (t->isEnabled())
         {
-            t.trigger();
+            t->trigger();
         }
     }
 }
 
+void Controller::publishMarkingChanges()
+{
+    const auto marking = m_net->getMarking(m_publishedVersion);
+    m_publishedVersion = marking.at("version").get<uint64_t>();
+
+    nlohmann::json changes = nlohmann::json::object();
+    for (auto&& [id, countJson] : marking.at("marking").items())
+    {
+        const auto count = countJson.get<uint32_t>();
+        const auto [it, isNew] = m_publishedMarking.try_emplace(id, count);
+        if (isNew || it->second != count) // places can change and then go back to the same count within an epoch
+        {
+            it->second = count;
+            changes[id] = count;
+        }
+    }
+    if (!changes.empty())
+    {
+        m_markingFeed.publish(std::move(changes));
+    }
+}
+
+nlohmann::json Controller::getMarkingUpdates(std::optional<uint64_t> sinceSequence, std::chrono::milliseconds timeout)
+{
+    if (sinceSequence.has_value())
+    {
+        auto changes = m_markingFeed.waitForChanges(sinceSequence.value(), timeout);
+        if (changes.isComplete)
+        {
+            nlohmann::json marking = nlohmann::json::object();
+            for (auto&& event : changes.events)
+            {
+                marking.update(event);
+            }
+            return {{"seq", changes.lastSequence}, {"full", false}, {"marking", std::move(marking)}};
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(m_netMtx);
+    return {{"seq", m_markingFeed.getLastSequence()}, {"full", true}, {"marking", m_publishedMarking}};
+}
+
 ControllerCallbacks Controller::createCallbacks()
 {
     return ControllerCallbacks{
-        .addToken = [this](nlohmann::json const& contentBlocks,
-                           std::string_view placeId) { addToken(contentBlocks, placeId); },
-        .getNetMarking = [this]() -> nlohmann::json { return getNet().getMarking(); },
-        .triggerManualTransition = [this](std::string_view const& id) { getNet().triggerTransition(id, true); }};
+        .addToken = [this](nlohmann::json contentBlocks, std::string_view placeId,
+                           std::optional<std::chrono::milliseconds> ttl) {
+            addToken(std::move(contentBlocks), placeId, ttl);
+        },
+        .addTokens = [this](std::vector<TokenRequest> requests) { return addTokens(std::move(requests)); },
+        .getNetMarking = [this](std::optional<uint64_t> sinceVersion) { return getMarking(sinceVersion); },
+        .getNetConfig = [this]() -> nlohmann::json const& { return getNet().getConfig(); },
+        .triggerManualTransition = [this](std::string_view const& id) { triggerManualTransition(id); },
+        .triggerManualTransitions =
+            [this](std::vector<std::string> const& ids) { return triggerManualTransitions(ids); },
+        .getMarkingUpdates = [this](std::optional<uint64_t> sinceSequence, std::chrono::milliseconds timeout) {
+            return getMarkingUpdates(sinceSequence, timeout);
+        }};
 }
 
 } // namespace bnet
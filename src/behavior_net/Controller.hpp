@@ -20,35 +20,89 @@
 #include <3rd_party/better_enums/enums.h>
 #include <behavior_net/Action.hpp>
 #include <behavior_net/PetriNet.hpp>
+#include <utils/ChangeFeed.hpp>
 
 #include <3rd_party/cpp-httplib/httplib.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace capybot
 {
 namespace bnet
 {
 
+/// @brief a token to be added to the net, see `Controller::addToken`
+struct TokenRequest
+{
+    nlohmann::json contentBlocks;
+    std::string placeId;
+    std::optional<std::chrono::milliseconds> ttl;
+
+    /// @param payload {"place_id": "...", "content_blocks": {...}, "ttl_ms": [optional] uint32_t}
+    static TokenRequest fromJson(nlohmann::json payload)
+    {
+        return TokenRequest{.contentBlocks = std::move(payload.at("content_blocks")),
+                            .placeId = payload.at("place_id").get<std::string>(),
+                            .ttl = payload.contains("ttl_ms")
+                                       ? std::optional(std::chrono::milliseconds(payload.at("ttl_ms").get<uint32_t>()))
+                                       : std::nullopt};
+    }
+
+    /// @brief parse a serialized `fromJson` payload in a single pass (SAX), straight into the request; the content
+    /// blocks are never copied
+    /// @throw INVALID_VALUE if `payload` is not valid json, or not a valid token request
+    static TokenRequest parse(std::string_view payload);
+};
+
+/// @brief per item outcome of a bulk request: std::nullopt on success, the error message otherwise
+using BulkResults = std::vector<std::optional<std::string>>;
+
+/// @return [{"success": true}, {"success": false, "error": "..."}, ...]
+inline nlohmann::json toJson(BulkResults const& results)
+{
+    auto json = nlohmann::json::array();
+    for (auto&& error : results)
+    {
+        json.push_back(error.has_value() ? nlohmann::json{{"success", false}, {"error", error.value()}}
+                                         : nlohmann::json{{"success", true}});
+    }
+    return json;
+}
+
 struct ControllerCallbacks
 {
-    std::function<void(nlohmann::json const& contentBlocks, std::string_view placeId)> addToken;
-    std::function<nlohmann::json()> getNetMarking;
+    std::function<void(nlohmann::json contentBlocks, std::string_view placeId,
+                       std::optional<std::chrono::milliseconds> ttl)>
+        addToken;
+    std::function<BulkResults(std::vector<TokenRequest> requests)> addTokens;
+    std::function<nlohmann::json(std::optional<uint64_t> sinceVersion)> getNetMarking;
+    std::function<nlohmann::json const&()> getNetConfig;
     std::function<void(std::string_view const& id)> triggerManualTransition;
+    std::function<BulkResults(std::vector<std::string> const& ids)> triggerManualTransitions;
+    std::function<nlohmann::json(std::optional<uint64_t> sinceSequence, std::chrono::milliseconds timeout)>
+        getMarkingUpdates;
 };
 
-BETTER_ENUM(ServerType, uint32_t, HTTP);
+BETTER_ENUM(ServerType, uint32_t, HTTP, TCP, SHM);
 
 class IServer
 {
     static constexpr const char* MODULE_TAG{"IServer"};
 
 public:
-    static std::unique_ptr<IServer> create(nlohmann::json const& controllerConfig,
-                                           ControllerCallbacks const& controllerCbs);
+    /// @return one server per server type in the config, e.g., "http_server"
+    static std::vector<std::unique_ptr<IServer>> create(nlohmann::json const& controllerConfig,
+                                                        ControllerCallbacks const& controllerCbs);
+
+    virtual ~IServer() = default;
 
     virtual void start() = 0;
     virtual void stop() = 0;
@@ -63,7 +117,29 @@ public:
 
     ~Controller() { stop(); }
 
-    void addToken(nlohmann::json const& contentBlocks, std::string_view placeId);
+    /// @param contentBlocks {"key": block, ...}; the blocks are moved into the token
+    /// @param ttl [optional] the token expires if not consumed within this time, see `Token::setExpiry`
+    void addToken(nlohmann::json contentBlocks, std::string_view placeId,
+                  std::optional<std::chrono::milliseconds> ttl = std::nullopt);
+
+    /// @brief add all tokens in one step, i.e., no epoch runs in between. Failing items do not prevent the others.
+    BulkResults addTokens(std::vector<TokenRequest> requests);
+
+    /// @see PetriNet::getMarking
+    nlohmann::json getMarking(std::optional<uint64_t> sinceVersion = std::nullopt);
+
+    /**
+     * @brief marking changes published after each epoch: {"seq": n, "full": bool, "marking": {"place_id": count}}.
+     * If `sinceSequence` is given, wait up to `timeout` for changes after it and return the number of tokens of the
+     * places that changed since ("full" = false; empty "marking" on timeout). Otherwise, or if the changes are no
+     * longer in the history, return the whole marking ("full" = true).
+     */
+    nlohmann::json getMarkingUpdates(std::optional<uint64_t> sinceSequence, std::chrono::milliseconds timeout);
+
+    void triggerManualTransition(std::string_view id);
+
+    /// @brief trigger all manual transitions, in order, in one step. Failing items do not prevent the others.
+    BulkResults triggerManualTransitions(std::vector<std::string> const& ids);
 
     void run();
 
@@ -71,6 +147,10 @@ public:
 
     void stop();
 
+    /// @brief one scheduler tick: check and execute the action places that are due, each on its own poll period
+    /// (default: "epoch_period_ms"), and fire enabled auto transitions. High priority transitions are fired first, on
+    /// every tick; normal ones on ticks that checked a place or changed the marking, and at least once per epoch. Then
+    /// sleep until the next place or lane is due.
     void runEpoch();
 
     PetriNet const& getNet() const { return *m_net; }
@@ -79,6 +159,20 @@ public:
 private:
     ControllerCallbacks createCallbacks();
 
+    /// @brief fire enabled auto transitions, once each
+    void fireTransitions(std::vector<Transition*> const& lane);
+
+    /// @brief publish the places whose number of tokens changed since the last call
+    void publishMarkingChanges();
+
+    using Clock = std::chrono::steady_clock;
+    struct PollSchedule
+    {
+        Place::SharedPtr place;
+        std::chrono::milliseconds period;
+        Clock::time_point nextPoll;
+    };
+
     ThreadPool m_tp;
     nlohmann::json const& m_config;
 
@@ -86,7 +180,23 @@ private:
     std::thread m_runDetachedThread;
 
     std::unique_ptr<PetriNet> m_net;
-    std::unique_ptr<IServer> m_server;
+    std::mutex m_netMtx; // serializes server requests with epochs
+    std::vector<std::unique_ptr<IServer>> m_servers;
+
+    std::vector<PollSchedule> m_pollSchedules; // action places only
+
+    // "high_priority_period_ms" [uint32_t][default: "epoch_period_ms"] max period between high lane evaluations; input
+    // action places of high priority transitions are polled at this period unless they set their own
+    std::chrono::milliseconds m_highPriorityPeriod;
+    std::vector<Transition*> m_highPriorityLane;
+    std::vector<Transition*> m_normalPriorityLane;
+    Clock::time_point m_nextEpoch;
+    uint64_t m_normalLaneVersion{0U}; // marking version after the normal lane last fired
+
+    static constexpr std::size_t MARKING_HISTORY_SIZE{64U};
+    ChangeFeed<nlohmann::json> m_markingFeed{MARKING_HISTORY_SIZE};
+    std::map<std::string, uint32_t> m_publishedMarking; // guarded by m_netMtx
+    std::optional<uint64_t> m_publishedVersion;        // guarded by m_netMtx
 };
 
 } // namespace bnet
@@ -23,6 +23,7 @@
 #include <behavior_net/Transition.hpp>
 #include <behavior_net/Types.hpp>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
 #include <sstream>
@@ -48,6 +49,11 @@ public:
     {
         m_places = Place::Factory::createPlaces(config);
         m_transitions = Transition::Factory::createTransitions(config, m_places);
+        for (auto&& [_, placePtr] : m_places)
+        {
+            placePtr->setVersionCounter(m_markingVersion);
+            placePtr->setNetNextExpiry(m_nextExpiry);
+        }
     }
 
     /// @param newToken token to be added; will be moved so a token cannot be added more than once as tokens within the
@@ -72,6 +78,57 @@ public:
         }
     }
 
+    /// @brief move expired tokens to the expiry place of their place, or drop them. Only tokens with a deadline are
+    /// visited, in deadline order; places are not visited at all before the earliest deadline of the net.
+    void expireTokens(Token::Clock::time_point now = Token::Clock::now())
+    {
+        if (now < *m_nextExpiry)
+        {
+            return;
+        }
+        for (auto&& [id, placePtr] : m_places)
+        {
+            for (auto&& token : placePtr->popExpiredTokens(now))
+            {
+                token->setExpiry(std::nullopt); // it would otherwise expire right away in the expiry place
+                const auto& expiryPlaceId = placePtr->getExpiryPlaceId();
+                if (!expiryPlaceId.has_value())
+                {
+                    LOG(DEBUG) << "expireTokens: token expired @ " << id << "; dropped" << log::endl;
+                    continue;
+                }
+                try
+                {
+                    m_places.at(expiryPlaceId.value())->insertToken(token);
+                    LOG(DEBUG) << "expireTokens: token expired @ " << id << "; moved to " << expiryPlaceId.value()
+                               << log::endl;
+                }
+                catch (Exception const& e)
+                {
+                    if (e.type() != +ExceptionType::CAPACITY_EXCEEDED)
+                    {
+                        throw;
+                    }
+                    LOG(WARN) << "expireTokens: token expired @ " << id << "; dropped since "
+                              << expiryPlaceId.value() << " is full" << log::endl;
+                }
+            }
+        }
+
+        // places only lower it, so it falls behind as tokens are consumed: recompute it while visiting them anyway
+        *m_nextExpiry = Token::Clock::time_point::max();
+        for (auto&& [_, placePtr] : m_places)
+        {
+            if (const auto next = placePtr->getNextExpiry())
+            {
+                *m_nextExpiry = std::min(*m_nextExpiry, next.value());
+            }
+        }
+    }
+
+    /// @return no token of the net expires before then; Token::Clock::time_point::max() if none has a deadline
+    Token::Clock::time_point getNextExpiry() const { return *m_nextExpiry; }
+
     void prettyPrintState() const
     {
         std::size_t max_id_size = 10;
@@ -142,20 +199,33 @@ public:
     auto& getTransitions() { return m_transitions; }
     auto& getPlaces() { return m_places; }
 
-    nlohmann::json getMarking() const
+    nlohmann::json const& getConfig() const { return m_config; }
+
+    /// @return incremented on every change to the number of tokens of a place
+    uint64_t getMarkingVersion() const { return *m_markingVersion; }
+
+    /// @return {"version": v, "marking": {"place_id": number of tokens}}; if `sinceVersion` is given, only places that
+    /// changed after it are included
+    nlohmann::json getMarking(std::optional<uint64_t> sinceVersion = std::nullopt) const
     {
         nlohmann::json m;
-        m["config"] = m_config; // TODO: ??
-        m["marking"] = {};
+        m["version"] = getMarkingVersion();
+        m["marking"] = nlohmann::json::object();
         for (auto&& [id, placePtr] : m_places)
         {
-            m["marking"][id] = placePtr->getNumberTokensTotal();
+            if (!sinceVersion.has_value() || placePtr->getVersion() > sinceVersion.value())
+            {
+                m["marking"][id] = placePtr->getNumberTokensTotal();
+            }
         }
         return m;
     }
 
 private:
     nlohmann::json m_config;
+    std::shared_ptr<uint64_t> m_markingVersion{std::make_shared<uint64_t>(0U)};
+    std::shared_ptr<Token::Clock::time_point> m_nextExpiry{
+        std::make_shared<Token::Clock::time_point>(Token::Clock::time_point::max())}; // see `expireTokens`
 
     Place::IdMap m_places;
     std::vector<Transition> m_transitions;
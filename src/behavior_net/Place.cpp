@@ -50,6 +50,36 @@ bool validatePlacesConfig(nlohmann::json const& netConfig, std::vector<std::stri
                 ids.push_back(id.value());
             }
         }
+
+        if (placeConfig.contains("token_ttl_ms") && !placeConfig.at("token_ttl_ms").is_number_unsigned())
+        {
+            errorMessages.push_back("Invalid `token_ttl_ms` (expected a non-negative integer) for place: " +
+                                    placeConfig.value("place_id", std::string{}));
+        }
+
+        if (placeConfig.contains("capacity") &&
+            (!placeConfig.at("capacity").is_number_unsigned() || placeConfig.at("capacity").get<uint32_t>() == 0U))
+        {
+            errorMessages.push_back("Invalid `capacity` (expected a positive integer) for place: " +
+                                    placeConfig.value("place_id", std::string{}));
+        }
+    }
+
+    // expiry places must exist
+    for (auto&& placeConfig : placeConfigsOpt.value())
+    {
+        if (!placeConfig.contains("expiry_place_id"))
+        {
+            continue;
+        }
+        const auto expiryPlaceId = getValueAtKey<std::string>(placeConfig, "expiry_place_id", errorMessages);
+        if (expiryPlaceId.has_value() &&
+            (std::find(ids.begin(), ids.end(), expiryPlaceId.value()) == ids.end() ||
+             expiryPlaceId.value() == placeConfig.value("place_id", std::string{})))
+        {
+            errorMessages.push_back("Invalid `expiry_place_id` (expected another existing place): " +
+                                    expiryPlaceId.value());
+        }
     }
 
     return errorMessages.empty();
@@ -71,14 +101,27 @@ void Place::setAssociatedAction(ThreadPool& tp, std::string const& type, nlohman
 
 void Place::insertToken(Token::SharedPtr token)
 {
+    if (isFull())
+    {
+        throw Exception(ExceptionType::CAPACITY_EXCEEDED, "Place::insertToken: place is full.")
+            .appendMetadata("place_id", getId())
+            .appendMetadata("capacity", m_capacity.value());
+    }
+
     if (isPassive())
     {
-        m_tokensAvailable.push_back({token, ActionExecutionStatus::SUCCESS});
+        makeAvailable({token, ActionExecutionStatus::SUCCESS});
     }
     else
     {
         m_tokensBusy.push_back(token);
+        if (const auto& deadline = token->getExpiry())
+        {
+            m_busyExpiries[token.get()] = m_busyExpiryQueue.emplace(deadline.value(), std::prev(m_tokensBusy.end()));
+            onDeadlineTracked(deadline.value());
+        }
     }
+    onNumberTokensChanged();
 }
 
 Token::SharedPtr Place::consumeToken(ActionExecutionStatusSet resultsAccepted)
@@ -112,6 +155,13 @@ Token::SharedPtr Place::consumeToken(ActionExecutionStatusSet resultsAccepted)
         token = m_tokensAvailable.front().tokenPtr;
         m_tokensAvailable.pop_front();
     }
+
+    if (const auto it = m_expiries.find(token.get()); it != m_expiries.end())
+    {
+        m_expiryQueue.erase(it->second);
+        m_expiries.erase(it);
+    }
+    onNumberTokensChanged();
     return token;
 }
 
@@ -140,8 +190,13 @@ void Place::checkActionResults()
             auto it = std::find(m_tokensBusy.begin(), m_tokensBusy.end(), result.tokenPtr);
             if (it != m_tokensBusy.end())
             {
+                if (const auto expiryIt = m_busyExpiries.find(it->get()); expiryIt != m_busyExpiries.end())
+                {
+                    m_busyExpiryQueue.erase(expiryIt->second);
+                    m_busyExpiries.erase(expiryIt);
+                }
                 m_tokensBusy.erase(it);
-                m_tokensAvailable.push_back(result);
+                makeAvailable(result);
             }
             else
             {
@@ -154,5 +209,50 @@ void Place::checkActionResults()
     }
 }
 
+std::vector<Token::SharedPtr> Place::popExpiredTokens(Token::Clock::time_point now)
+{
+    std::vector<Token::SharedPtr> expired;
+    while (!m_expiryQueue.empty() && m_expiryQueue.begin()->first <= now)
+    {
+        const auto tokenIt = m_expiryQueue.begin()->second;
+        expired.push_back(tokenIt->tokenPtr);
+        m_expiries.erase(tokenIt->tokenPtr.get());
+        m_tokensAvailable.erase(tokenIt);
+        m_expiryQueue.erase(m_expiryQueue.begin());
+    }
+    while (!m_busyExpiryQueue.empty() && m_busyExpiryQueue.begin()->first <= now)
+    {
+        const auto tokenIt = m_busyExpiryQueue.begin()->second;
+        m_action->cancel(*tokenIt); // its result must not be reported anymore
+        expired.push_back(*tokenIt);
+        m_busyExpiries.erase(tokenIt->get());
+        m_tokensBusy.erase(tokenIt);
+        m_busyExpiryQueue.erase(m_busyExpiryQueue.begin());
+    }
+    if (!expired.empty())
+    {
+        onNumberTokensChanged();
+    }
+    return expired;
+}
+
+void Place::makeAvailable(ActionExecutionResult const& result)
+{
+    m_tokensAvailable.push_back(result);
+
+    auto deadline = result.tokenPtr->getExpiry();
+    if (m_tokenTtl.has_value())
+    {
+        const auto placeDeadline = Token::Clock::now() + m_tokenTtl.value();
+        deadline = deadline.has_value() ? std::min(deadline.value(), placeDeadline) : placeDeadline;
+    }
+    if (deadline.has_value())
+    {
+        const auto queueIt = m_expiryQueue.emplace(deadline.value(), std::prev(m_tokensAvailable.end()));
+        m_expiries[result.tokenPtr.get()] = queueIt;
+        onDeadlineTracked(deadline.value());
+    }
+}
+
 } // namespace bnet
 } // namespace capybot
@@ -22,9 +22,13 @@
 #include <behavior_net/Token.hpp>
 
 #include <3rd_party/nlohmann/json.hpp>
+#include <algorithm>
+#include <limits>
 #include <list>
+#include <map>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 namespace capybot
 {
@@ -57,14 +61,32 @@ public:
         {
             for (auto&& config : actionsConfig)
             {
-                places.at(config["place_id"])->setAssociatedAction(tp, config["type"], config["params"]);
+                auto& place = places.at(config["place_id"]);
+                place->setAssociatedAction(tp, config["type"], config["params"]);
+                if (config.contains("poll_period_ms"))
+                {
+                    const auto periodMs = config.at("poll_period_ms").get<uint32_t>();
+                    if (periodMs == 0U)
+                    {
+                        throw Exception(ExceptionType::INVALID_CONFIG_FILE, "Invalid `poll_period_ms` (expected > 0).")
+                            .appendMetadata("place_id", place->getId());
+                    }
+                    place->setPollPeriod(std::chrono::milliseconds(periodMs));
+                }
             }
         }
     };
 
     Place(nlohmann::json config)
         : m_id(config.at("place_id").get<std::string>())
+        , m_capacity(config.contains("capacity") ? std::optional(config.at("capacity").get<uint32_t>()) : std::nullopt)
         , m_action(nullptr)
+        , m_tokenTtl(config.contains("token_ttl_ms")
+                         ? std::optional(std::chrono::milliseconds(config.at("token_ttl_ms").get<uint32_t>()))
+                         : std::nullopt)
+        , m_expiryPlaceId(config.contains("expiry_place_id")
+                              ? std::optional(config.at("expiry_place_id").get<std::string>())
+                              : std::nullopt)
     {
     }
 
@@ -74,9 +96,65 @@ public:
     void executeActionAsync();
     void checkActionResults();
 
+    /// @brief remove tokens whose deadline has passed, cancelling the action execution of busy ones; costs O(log n)
+    /// per expired token
+    std::vector<Token::SharedPtr> popExpiredTokens(Token::Clock::time_point now);
+
+    /// @brief share the net marking version counter; changes to the number of tokens increment it
+    void setVersionCounter(std::shared_ptr<uint64_t> counter) { m_netVersion = std::move(counter); }
+
+    /// @brief share the net earliest deadline; it is lowered to the deadline of every token tracked from now on, so it
+    /// never comes after the earliest deadline of this place (but may come before it, once tokens leave)
+    void setNetNextExpiry(std::shared_ptr<Token::Clock::time_point> nextExpiry)
+    {
+        m_netNextExpiry = std::move(nextExpiry);
+    }
+
+    /// @return earliest deadline of the tokens in this place; std::nullopt if none of them has one
+    std::optional<Token::Clock::time_point> getNextExpiry() const
+    {
+        std::optional<Token::Clock::time_point> next;
+        if (!m_expiryQueue.empty())
+        {
+            next = m_expiryQueue.begin()->first;
+        }
+        if (!m_busyExpiryQueue.empty())
+        {
+            next = next.has_value() ? std::min(next.value(), m_busyExpiryQueue.begin()->first)
+                                    : m_busyExpiryQueue.begin()->first;
+        }
+        return next;
+    }
+
+    /// @return marking version of the last change to the number of tokens in this place
+    uint64_t getVersion() const { return m_version; }
+
+    /// @return where expired tokens should be moved to; std::nullopt if they are dropped
+    std::optional<std::string> const& getExpiryPlaceId() const { return m_expiryPlaceId; }
+
     bool isPassive() const { return m_action == nullptr; }
+
+    /// @return how often the controller executes and checks the place action; std::nullopt for the epoch period
+    std::optional<std::chrono::milliseconds> const& getPollPeriod() const { return m_pollPeriod; }
+    void setPollPeriod(std::chrono::milliseconds period) { m_pollPeriod = period; }
     std::string const& getId() const { return m_id; }
 
+    /// @return max number of tokens in the place; std::nullopt if unbounded
+    std::optional<uint32_t> const& getCapacity() const { return m_capacity; }
+
+    /// @return how many more tokens can be inserted
+    uint32_t getFreeCapacity() const
+    {
+        if (!m_capacity.has_value())
+        {
+            return std::numeric_limits<uint32_t>::max();
+        }
+        const auto total = getNumberTokensTotal();
+        return total < m_capacity.value() ? m_capacity.value() - total : 0U;
+    }
+
+    bool isFull() const { return getFreeCapacity() == 0U; }
+
     uint32_t getNumberTokensBusy() const { return m_tokensBusy.size(); }
     uint32_t getNumberTokensTotal() const { return m_tokensBusy.size() + m_tokensAvailable.size(); }
     uint32_t getNumberTokensAvailable(ActionExecutionStatusSet status = 0U) const
@@ -92,12 +170,45 @@ public:
     std::list<Token::SharedPtr> const& getTokensBusy() const { return m_tokensBusy; }
 
 private:
+    using AvailableTokenList = std::list<ActionExecutionResult>;
+
+    /// @brief add to `m_tokensAvailable`, tracking the token deadline if it has one
+    void makeAvailable(ActionExecutionResult const& result);
+
+    void onNumberTokensChanged() { m_version = m_netVersion ? ++(*m_netVersion) : m_version + 1U; }
+
+    void onDeadlineTracked(Token::Clock::time_point deadline)
+    {
+        if (m_netNextExpiry)
+        {
+            *m_netNextExpiry = std::min(*m_netNextExpiry, deadline);
+        }
+    }
+
     std::string m_id;
+    std::optional<uint32_t> m_capacity; // "capacity" [uint32_t][optional] max number of tokens in the place
     Action::UniquePtr m_action;
+    std::optional<std::chrono::milliseconds> m_pollPeriod; // "poll_period_ms" [uint32_t][optional] in action config
+
+    uint64_t m_version{0U};
+    std::shared_ptr<uint64_t> m_netVersion;
 
     std::list<ActionExecutionResult> m_tokensAvailable; // ready to be consumed
 
+    // "token_ttl_ms" [uint32_t][optional] max time tokens stay available before expiring; tokens can also carry their
+    // own deadline (Token::setExpiry), which applies while busy too. "expiry_place_id" [string][optional] where expired
+    // tokens go; dropped if unset.
+    std::optional<std::chrono::milliseconds> m_tokenTtl;
+    std::optional<std::string> m_expiryPlaceId;
+    std::shared_ptr<Token::Clock::time_point> m_netNextExpiry;
+    using ExpiryQueue = std::multimap<Token::Clock::time_point, AvailableTokenList::iterator>;
+    ExpiryQueue m_expiryQueue;                                         // available tokens with deadline, by deadline
+    std::unordered_map<Token const*, ExpiryQueue::iterator> m_expiries; // for removing consumed tokens
+
     std::list<Token::SharedPtr> m_tokensBusy; // either in action exec or waiting for exec
+    using BusyExpiryQueue = std::multimap<Token::Clock::time_point, std::list<Token::SharedPtr>::iterator>;
+    BusyExpiryQueue m_busyExpiryQueue;                                          // busy tokens with deadline
+    std::unordered_map<Token const*, BusyExpiryQueue::iterator> m_busyExpiries; // for removing completed tokens
 };
 
 } // namespace bnet
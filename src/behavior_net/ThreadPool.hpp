@@ -19,7 +19,9 @@
 
 #include <3rd_party/taskflow/taskflow.hpp>
 #include <behavior_net/Types.hpp>
+#include <utils/ConcurrencyLimiter.hpp>
 #include <utils/Logger.hpp>
+#include <utils/TimingWheel.hpp>
 
 #include <atomic>
 #include <condition_variable>
@@ -50,8 +52,11 @@ public:
         static constexpr const char* MODULE_TAG{"ThreadPool::Task"};
 
     public:
-        Task(std::function<ActionExecutionStatus()> func)
+        /// @param onSkipped [optional] called instead of `func` if the task is skipped, e.g., to skip the tasks it
+        /// would have executed
+        Task(std::function<ActionExecutionStatus()> func, std::function<void()> onSkipped = nullptr)
             : m_func(func)
+            , m_onSkipped(std::move(onSkipped))
             , m_return(ActionExecutionStatus::NOT_STARTED)
             , m_started(false)
             , m_done(false)
@@ -61,10 +66,25 @@ public:
         /// Execute task synchronously - this call will block
         void executeSync()
         {
+            bool skip{false};
             {
-                std::lock_guard<std::mutex> lk(m_mtx); // probably unnecessary
+                std::lock_guard<std::mutex> lk(m_mtx);
                 m_started = true;
-                m_done = false;
+                skip = m_cancelled;
+                m_done = skip; // skipped tasks still signal completion to waiters
+                if (skip)
+                {
+                    m_return = ActionExecutionStatus::ERROR;
+                }
+            }
+            if (skip)
+            {
+                if (m_onSkipped)
+                {
+                    m_onSkipped();
+                }
+                m_waitCondition.notify_all();
+                return;
             }
             try
             {
@@ -107,11 +127,33 @@ public:
             return ActionExecutionStatus::QUERRY_TIMEOUT;
         }
 
+        /// Skip execution if the task has not started yet; a running function is not interrupted
+        void cancel()
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_cancelled = true;
+        }
+
+        bool isCancelled() const
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            return m_cancelled;
+        }
+
+        /// Block until the task is done or skipped; it must have been added to the thread pool
+        void wait() const
+        {
+            std::unique_lock<std::mutex> lk(m_mtx);
+            m_waitCondition.wait(lk, [this] { return m_done; });
+        }
+
     private:
         const std::function<ActionExecutionStatus()> m_func;
+        const std::function<void()> m_onSkipped;
         ActionExecutionStatus m_return;
         bool m_started;
         bool m_done;
+        bool m_cancelled{false};
         mutable std::condition_variable m_waitCondition;
         mutable std::mutex m_mtx;
     };
@@ -132,16 +174,28 @@ public:
     /// @brief add task to the thread pool queue for execution
     void executeAsync(Task& task)
     {
-        if (m_stopped.load()) // ignore new tasks while on destruction
+        if (m_stopped.load()) // skip new tasks while on destruction; they are done for whoever waits for them
         {
+            task.cancel();
+            task.executeSync();
             return;
         }
         m_executor.silent_async([&task] { task.executeSync(); });
     }
 
+    uint32_t getNumberWorkers() const { return static_cast<uint32_t>(m_executor.num_workers()); }
+
+    /// @brief timers shared by all actions using this pool; advanced on every `Action::getEpochResults` call
+    TimingWheel& getTimingWheel() { return m_timingWheel; }
+
+    /// @brief in flight limits shared by all actions using this pool, e.g., per remote host
+    ConcurrencyLimiter& getConcurrencyLimiter() { return m_concurrencyLimiter; }
+
 private:
     std::atomic_bool m_stopped{false};
     tf::Executor m_executor;
+    TimingWheel m_timingWheel;
+    ConcurrencyLimiter m_concurrencyLimiter;
 };
 
 } // namespace bnet
@@ -18,8 +18,10 @@
 #pragma once
 
 #include <3rd_party/nlohmann/json.hpp>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 
 #include <behavior_net/Common.hpp>
@@ -39,6 +41,7 @@ public:
     using UniquePtr = std::unique_ptr<Token>;
     using SharedPtr = std::shared_ptr<Token>;
     using ConstSharedPtr = std::shared_ptr<const Token>;
+    using Clock = std::chrono::steady_clock;
 
     Token() = default;
     ~Token() = default;
@@ -63,7 +66,7 @@ public:
 
     void addContentBlock(std::string const& key, nlohmann::json blockContent)
     {
-        const auto [it, success] = m_contentBlocks.insert({key, blockContent});
+        const auto [it, success] = m_contentBlocks.try_emplace(key, std::move(blockContent));
         if (!success)
         {
             throw Exception(ExceptionType::RUNTIME_ERROR, "Token::addContentBlock: token already has a block for key.")
@@ -102,8 +105,14 @@ public:
         m_contentBlocks.swap(matchedBlocks);
     }
 
+    /// @brief [optional] the token is dropped, or moved to the place expiry place, if still not consumed by then.
+    /// Tokens created by transitions do not inherit it.
+    void setExpiry(std::optional<Clock::time_point> expiry) { m_expiry = expiry; }
+    std::optional<Clock::time_point> const& getExpiry() const { return m_expiry; }
+
 private:
     std::unordered_map<std::string, nlohmann::json> m_contentBlocks; // TODO: use simple json, no need for a map
+    std::optional<Clock::time_point> m_expiry;
 };
 
 } // namespace bnet
@@ -142,6 +142,17 @@ bool validateTransitionsConfig(nlohmann::json const& netConfig, std::vector<std:
             }
         }
 
+        // has valid priority
+        if (transitionConfig.contains("priority"))
+        {
+            const auto priorityStrOpt = getValueAtKey<std::string>(transitionConfig, "priority", errorMessages);
+            if (priorityStrOpt.has_value() &&
+                !TransitionPriority::_from_string_nocase_nothrow(priorityStrOpt.value().c_str()))
+            {
+                errorMessages.push_back("Invalid transition priority `" + priorityStrOpt.value() + "`.");
+            }
+        }
+
         // arcs
         {
             const auto arcConfigsOpt =
@@ -167,6 +178,9 @@ REGISTER_NET_CONFIG_VALIDATOR(&validateTransitionsConfig, "TransitionsConfigVali
 Transition::Transition(nlohmann::json config, Place::IdMap const& places)
     : m_id(config.at("transition_id").get<std::string>())
     , m_type(TransitionType::UNDEFINED)
+    , m_priority(config.contains("priority")
+                     ? TransitionPriority::_from_string_nocase(config.at("priority").get<std::string>().c_str())
+                     : +TransitionPriority::NORMAL)
 {
     /**
      * From here on, the config is assumed to be valid. See `validateTransitionsConfig`
@@ -232,12 +246,18 @@ Transition::Transition(nlohmann::json config, Place::IdMap const& places)
 
 void Transition::trigger()
 {
-    if (!isEnabled())
+    if (!hasInputTokens())
     {
         throw Exception(ExceptionType::LOGIC_ERROR,
                         "Transition::trigger: trying to trigger disabled transition. Use `isEnabled` first.")
             .appendMetadata("transition_id", m_id);
     }
+    if (!hasOutputCapacity())
+    {
+        throw Exception(ExceptionType::CAPACITY_EXCEEDED,
+                        "Transition::trigger: output places cannot take more tokens. Use `isEnabled` first.")
+            .appendMetadata("transition_id", m_id);
+    }
 
     std::vector<Token::SharedPtr> consumedTokens;
     for (auto&& arc : m_inputArcs)
@@ -23,6 +23,7 @@
 #include <behavior_net/Types.hpp>
 
 #include <3rd_party/nlohmann/json.hpp>
+#include <algorithm>
 #include <regex>
 #include <string>
 #include <vector>
@@ -87,7 +88,13 @@ public:
 
     bool isManual() const { return m_type == +TransitionType::MANUAL; }
 
-    bool isEnabled() const
+    TransitionPriority getPriority() const { return m_priority; }
+    std::vector<Arc> const& getInputArcs() const { return m_inputArcs; }
+
+    bool isEnabled() const { return hasInputTokens() && hasOutputCapacity(); }
+
+    /// @return whether all input places have tokens to be consumed
+    bool hasInputTokens() const
     {
         for (auto&& arc : m_inputArcs)
         {
@@ -99,6 +106,27 @@ public:
         return true;
     }
 
+    /// @return whether output places with capacity can take the produced tokens; a full output place disables the
+    /// transition, so backpressure propagates upstream
+    bool hasOutputCapacity() const
+    {
+        for (auto&& arc : m_outputArcs)
+        {
+            if (!arc.place->getCapacity().has_value())
+            {
+                continue;
+            }
+            const auto isSamePlace = [&arc](Arc const& other) { return other.place == arc.place; };
+            const auto produced = std::count_if(m_outputArcs.begin(), m_outputArcs.end(), isSamePlace);
+            const auto consumed = std::count_if(m_inputArcs.begin(), m_inputArcs.end(), isSamePlace);
+            if (produced > consumed && arc.place->getFreeCapacity() < produced - consumed)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     void trigger();
 
 private:
@@ -107,6 +135,7 @@ private:
     std::string m_id;
 
     TransitionType m_type;
+    TransitionPriority m_priority; // "priority" [string][default: "normal"] "normal" or "high" lane
 };
 
 } // namespace bnet
@@ -61,6 +61,12 @@ BETTER_ENUM(TransitionType, uint32_t, UNDEFINED = 0,
             MANUAL // can only be triggered by user
 )
 
+/// Transition priority lane - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(TransitionPriority, uint32_t,
+            NORMAL = 0, // evaluated when inputs may have changed, and once per epoch
+            HIGH        // evaluated first, and every "high_priority_period_ms"
+)
+
 /// Arc type (from transition perspective) - using BETTER_ENUM for helper str member functions
 BETTER_ENUM(ArcType, uint32_t, UNDEFINED = 0,
             INPUT, // input to transition
@@ -72,7 +78,8 @@ BETTER_ENUM(ExceptionType, uint32_t, NONE = 0,
             LOGIC_ERROR,        //
             INVALID_VALUE,      // bad parameter or bad argument
             NOT_IMPLEMENTED,    //
-            INVALID_CONFIG_FILE // there is an issue with a config file, e.g., missing param, invalid param, ...
+            INVALID_CONFIG_FILE, // there is an issue with a config file, e.g., missing param, invalid param, ...
+            CAPACITY_EXCEEDED    // a place is full; the operation can be retried once tokens are consumed
 )
 
 } // namespace bnet
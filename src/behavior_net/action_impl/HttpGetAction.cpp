@@ -17,6 +17,10 @@
 
 #include <behavior_net/action_impl/HttpGetAction.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
 namespace capybot
 {
 namespace bnet
@@ -24,5 +28,370 @@ namespace bnet
 
 REGISTER_ACTION_TYPE(HttpGetAction);
 
+namespace
+{
+
+/// @brief parse either a plain status string or a {"status": <status>, "eta_ms": <int>} object
+std::optional<HttpGetAction::Response> parseResponseBody(std::string const& body)
+{
+    if (const auto status = ActionExecutionStatus::_from_string_nothrow(body.c_str()))
+    {
+        return HttpGetAction::Response{.status = status.value(), .retryAfter = std::nullopt};
+    }
+
+    const auto json = nlohmann::json::parse(body, nullptr, false);
+    if (json.is_discarded() || !json.is_object() || !json.contains("status") || !json.at("status").is_string())
+    {
+        return std::nullopt;
+    }
+    const auto status = ActionExecutionStatus::_from_string_nothrow(json.at("status").get<std::string>().c_str());
+    if (!status)
+    {
+        return std::nullopt;
+    }
+
+    HttpGetAction::Response response{.status = status.value(), .retryAfter = std::nullopt};
+    if (json.contains("eta_ms") && json.at("eta_ms").is_number())
+    {
+        response.retryAfter = std::chrono::milliseconds(std::max<int64_t>(0, json.at("eta_ms").get<int64_t>()));
+    }
+    return response;
+}
+
+/// @brief hedged requests need this many latency samples for the host before a backup request is ever sent
+constexpr std::size_t HEDGING_MIN_SAMPLES{20U};
+
+/// @brief how often `stop` shuts the sockets of the requests in flight down until they all returned
+constexpr std::chrono::milliseconds STOP_RETRY_PERIOD{10};
+
+/// @brief `Retry-After` in delay-seconds format; HTTP-date values are ignored
+std::optional<std::chrono::milliseconds> parseRetryAfter(std::string const& value)
+{
+    char* end{nullptr};
+    const double seconds = std::strtod(value.c_str(), &end);
+    if (value.empty() || end != value.c_str() + value.size() || !std::isfinite(seconds) || seconds < 0.)
+    {
+        return std::nullopt;
+    }
+    return std::chrono::milliseconds(std::llround(seconds * 1000.));
+}
+
+void setTimeouts(httplib::Client& client, std::chrono::milliseconds timeout)
+{
+    client.set_connection_timeout(timeout);
+    client.set_read_timeout(timeout);
+    client.set_write_timeout(timeout);
+}
+
+} // namespace
+
+void HttpGetAction::updatePollSchedule(Token const* token, Response const& response)
+{
+    std::lock_guard<std::mutex> lk(m_pollSchedulesMtx);
+
+    if (response.status != +ActionExecutionStatus::IN_PROGRESS)
+    {
+        m_pollSchedules.erase(token);
+        return;
+    }
+
+    auto& schedule = m_pollSchedules[token];
+    std::chrono::milliseconds delay{0};
+    if (response.retryAfter.has_value()) // agent knows best
+    {
+        delay = response.retryAfter.value();
+        schedule.backoff = std::chrono::milliseconds(0);
+    }
+    else if (m_pollBackoffInitial.count() > 0)
+    {
+        schedule.backoff = schedule.backoff.count() > 0 ? std::min(schedule.backoff * 2, m_pollBackoffMax)
+                                                        : std::min(m_pollBackoffInitial, m_pollBackoffMax);
+        delay = schedule.backoff;
+    }
+
+    schedule.nextPoll = delay.count() > 0 ? std::optional(TimingWheel::Clock::now() + delay) : std::nullopt;
+}
+
+ActionExecutionStatus HttpGetAction::parseCircuitOpenStatus(nlohmann::json const& config)
+{
+    if (!config.contains("circuit_open_status"))
+    {
+        return ActionExecutionStatus::ERROR;
+    }
+    // tokens must leave the place, as they would never be polled again while the circuit stays open
+    return Action::parseCompletedStatus("circuit_open_status", config.at("circuit_open_status").get<std::string>());
+}
+
+HttpGetAction::Response HttpGetAction::circuitBreakerRequest(std::string const& host, int port,
+                                                             std::function<Response()> const& sendRequest)
+{
+    if (m_circuitBreakerThreshold == 0U)
+    {
+        return sendRequest();
+    }
+
+    const auto hostKey = host + ":" + std::to_string(port);
+    CircuitBreaker* breaker{nullptr};
+    {
+        std::lock_guard<std::mutex> lk(m_circuitBreakersMtx);
+        breaker = &m_circuitBreakers.try_emplace(hostKey, m_circuitBreakerThreshold, m_circuitBreakerOpenDuration)
+                       .first->second; // references are stable across rehashing
+    }
+
+    if (!breaker->tryAcquire())
+    {
+        LOG(DEBUG) << "circuit open for " << hostKey << "; resolving request to " << m_circuitOpenStatus._to_string()
+                   << log::endl;
+        const auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(breaker->getRemainingOpenTime());
+        return Response{.status = m_circuitOpenStatus,
+                        .retryAfter = remaining.count() > 0 ? std::optional(remaining) : std::nullopt,
+                        .hostFailure = false,
+                        .shortCircuited = true};
+    }
+
+    auto response = sendRequest();
+    if (response.hostFailure)
+    {
+        breaker->recordFailure();
+        if (breaker->getState() == CircuitBreaker::State::OPEN)
+        {
+            LOG(WARN) << "circuit opened for " << hostKey << log::endl;
+        }
+    }
+    else
+    {
+        breaker->recordSuccess();
+    }
+    return response;
+}
+
+HttpGetAction::~HttpGetAction()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_hedgingMtx);
+        m_isHedgingStopping = true;
+    }
+    m_hedgingCv.notify_all();
+    for (auto&& worker : m_hedgingWorkers)
+    {
+        worker.join();
+    }
+}
+
+void HttpGetAction::stop()
+{
+    std::unique_lock<std::mutex> lk(m_activeClientsMtx);
+    m_isStopping = true;
+    // a client stopped before its socket is open would not notice: stop again until all requests have returned
+    while (!m_activeClients.empty())
+    {
+        for (auto* client : m_activeClients)
+        {
+            client->stop();
+        }
+        m_activeClientsCv.wait_for(lk, STOP_RETRY_PERIOD);
+    }
+}
+
+HttpGetAction::Response HttpGetAction::hedgedRequest(std::string const& host, int port, std::string const& path)
+{
+    const auto hostKey = host + ":" + std::to_string(port);
+    const auto hedgingDelay = m_latencyTracker->getPercentile(hostKey, m_hedgingPercentile, HEDGING_MIN_SAMPLES);
+    if (!hedgingDelay)
+    {
+        return trackedRequest(m_latencyTracker, host, port, path, m_requestTimeout);
+    }
+
+    auto hedged = std::make_shared<HedgedRequest>();
+    hedged->host = host;
+    hedged->port = port;
+    hedged->path = path;
+    hedged->hedgingTime = std::chrono::steady_clock::now() + *hedgingDelay;
+    hedged->primaryClient = std::make_shared<httplib::Client>(host, port);
+    hedged->backupClient = std::make_shared<httplib::Client>(host, port);
+    setTimeouts(*hedged->primaryClient, m_requestTimeout);
+    setTimeouts(*hedged->backupClient, m_requestTimeout);
+    {
+        std::unique_lock<std::mutex> lk(m_hedgingMtx);
+        if (m_hedgesInFlight >= m_hedgingWorkers.size())
+        {
+            lk.unlock();
+            LOG(DEBUG) << "all hedging workers are busy; not hedging request @ " << hostKey << path << log::endl;
+            return trackedRequest(m_latencyTracker, host, port, path, m_requestTimeout);
+        }
+        ++m_hedgesInFlight;
+        m_hedgingQueue.push_back(hedged);
+    }
+    m_hedgingCv.notify_one();
+
+    const auto start = std::chrono::steady_clock::now();
+    auto response = request(*hedged->primaryClient, host, port, path);
+    const auto latency = std::chrono::steady_clock::now() - start;
+
+    std::unique_lock<std::mutex> lk(hedged->mtx);
+    hedged->isPrimaryDone = true;
+    hedged->cv.notify_all(); // the worker may still be waiting for the hedging time
+    if (!hedged->isPrimaryCancelled)
+    {
+        m_latencyTracker->record(hostKey, std::chrono::duration_cast<LatencyTracker::Duration>(latency));
+    }
+    if (response.status != +ActionExecutionStatus::ERROR)
+    {
+        if (hedged->isBackupSent && !hedged->isBackupDone)
+        {
+            hedged->isBackupCancelled = true;
+            hedged->backupClient->stop();
+        }
+        return response;
+    }
+
+    // cancelled by a successful backup request, or failed: either way, the backup request may still succeed
+    hedged->cv.wait(lk, [&hedged]() { return !hedged->isBackupSent || hedged->isBackupDone; });
+    if (hedged->backupResponse.has_value() && hedged->backupResponse->status != +ActionExecutionStatus::ERROR)
+    {
+        return hedged->backupResponse.value();
+    }
+    return response;
+}
+
+void HttpGetAction::runHedgingWorker()
+{
+    while (true)
+    {
+        std::shared_ptr<HedgedRequest> hedged;
+        {
+            std::unique_lock<std::mutex> lk(m_hedgingMtx);
+            m_hedgingCv.wait(lk, [this]() { return m_isHedgingStopping || !m_hedgingQueue.empty(); });
+            if (m_isHedgingStopping)
+            {
+                return;
+            }
+            hedged = std::move(m_hedgingQueue.front());
+            m_hedgingQueue.pop_front();
+        }
+
+        sendBackupRequest(*hedged);
+
+        std::lock_guard<std::mutex> lk(m_hedgingMtx);
+        --m_hedgesInFlight;
+    }
+}
+
+void HttpGetAction::sendBackupRequest(HedgedRequest& hedged)
+{
+    {
+        std::unique_lock<std::mutex> lk(hedged.mtx);
+        if (hedged.cv.wait_until(lk, hedged.hedgingTime, [&hedged]() { return hedged.isPrimaryDone; }))
+        {
+            return;
+        }
+        hedged.isBackupSent = true;
+    }
+
+    LOG(DEBUG) << "no response in time; hedging request @ " << hedged.host << ":" << hedged.port << hedged.path
+               << log::endl;
+    const auto start = std::chrono::steady_clock::now();
+    auto response = request(*hedged.backupClient, hedged.host, hedged.port, hedged.path);
+    const auto latency = std::chrono::steady_clock::now() - start;
+
+    {
+        std::lock_guard<std::mutex> lk(hedged.mtx);
+        hedged.isBackupDone = true;
+        if (!hedged.isBackupCancelled)
+        {
+            m_latencyTracker->record(hedged.host + ":" + std::to_string(hedged.port),
+                                     std::chrono::duration_cast<LatencyTracker::Duration>(latency));
+        }
+        if (!hedged.isPrimaryDone && response.status != +ActionExecutionStatus::ERROR)
+        {
+            hedged.isPrimaryCancelled = true;
+            hedged.primaryClient->stop();
+        }
+        hedged.backupResponse = response;
+    }
+    hedged.cv.notify_all();
+}
+
+HttpGetAction::Response HttpGetAction::trackedRequest(std::shared_ptr<LatencyTracker> const& tracker,
+                                                      std::string const& host, int port, std::string const& path,
+                                                      std::chrono::milliseconds timeout)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto response = request(host, port, path, timeout);
+    tracker->record(host + ":" + std::to_string(port),
+                    std::chrono::duration_cast<LatencyTracker::Duration>(std::chrono::steady_clock::now() - start));
+    return response;
+}
+
+HttpGetAction::Response HttpGetAction::request(std::string const& host, int port, std::string const& path,
+                                               std::chrono::milliseconds timeout)
+{
+    httplib::Client client(host, port);
+    setTimeouts(client, timeout);
+    return request(client, host, port, path);
+}
+
+HttpGetAction::Response HttpGetAction::request(httplib::Client& client, std::string const& host, int port,
+                                               std::string const& path)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_activeClientsMtx);
+        if (m_isStopping)
+        {
+            return Response{.status = ActionExecutionStatus::ERROR, .retryAfter = std::nullopt};
+        }
+        m_activeClients.insert(&client);
+    }
+    httplib::Result res = client.Get(path);
+    {
+        std::lock_guard<std::mutex> lk(m_activeClientsMtx);
+        m_activeClients.erase(&client);
+    }
+    m_activeClientsCv.notify_all();
+
+    std::stringstream logMsg;
+    logMsg << "HttpGetAction :: requesting @ " << host << ":" << port << path << " ... ";
+
+    Response response{.status = ActionExecutionStatus::NOT_STARTED, .retryAfter = std::nullopt};
+    if (!res)
+    {
+        auto err = res.error();
+        logMsg << "ERROR; HTTP error: " << httplib::to_string(err) << "\n";
+        response.status = ActionExecutionStatus::ERROR;
+        response.hostFailure = true;
+        LOG(ERROR) << logMsg.str();
+    }
+    else if (res->status < 200 || res->status >= 300)
+    {
+        logMsg << "ERROR; response status code: " << res->status << "\n";
+        response.status = ActionExecutionStatus::ERROR;
+        response.hostFailure = true;
+        LOG(ERROR) << logMsg.str();
+    }
+    else
+    {
+        const auto maybeResponse = parseResponseBody(res->body);
+        if (maybeResponse)
+        {
+            logMsg << "Received " << res->body << "; response status code: " << res->status << "\n";
+            response = maybeResponse.value();
+            if (!response.retryAfter.has_value() && res->has_header("Retry-After"))
+            {
+                response.retryAfter = parseRetryAfter(res->get_header_value("Retry-After"));
+            }
+            LOG(DEBUG) << logMsg.str();
+        }
+        else
+        {
+            logMsg << "ERROR; response status code: " << res->status << "; unrecognized response body: " << res->body
+                   << "\n";
+            response.status = ActionExecutionStatus::ERROR;
+            LOG(ERROR) << logMsg.str();
+        }
+    }
+    return response;
+}
+
 } // namespace bnet
 } // namespace capybot
@@ -23,8 +23,21 @@
 
 #include <3rd_party/cpp-httplib/httplib.h>
 
-#include <list>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <utils/CircuitBreaker.hpp>
+#include <utils/LatencyTracker.hpp>
 #include <utils/Logger.hpp>
+#include <utils/RequestCoalescer.hpp>
 
 namespace capybot
 {
@@ -38,25 +51,102 @@ namespace bnet
  * requests to query the action status. These two types of requests can have different paths, e.g.,
  * <host>:<port>/execute/action/abc and <host>:<port>/status/action/abc.
  *
+ * Responses are either a plain ActionExecutionStatus string (e.g., "IN_PROGRESS") or a JSON object such as
+ * {"status": "IN_PROGRESS", "eta_ms": 20000}. Along with IN_PROGRESS, agents can hint when to poll next with `eta_ms`
+ * or a `Retry-After` header (seconds); the status is not queried again before then. Without a hint, polling backs off
+ * exponentially if "poll_backoff_initial_ms" is set, and happens every epoch otherwise.
+ *
+ * Identical requests (same resolved host, port, and path) issued concurrently by several tokens can optionally be
+ * coalesced into a single GET, whose response is shared by all of them.
+ *
+ * Status requests are idempotent and can optionally be hedged: if no response arrives within the host's latency
+ * percentile "hedging_percentile" (tracked over recent requests), a second identical request is sent and the first
+ * successful response wins and cancels the other one. The first request is sent from the calling thread; backup
+ * requests are sent by up to "max_hedged_requests" workers owned by the action, and requests are not hedged while all
+ * of them are busy. Execute requests are never hedged since they would trigger the client action twice.
+ *
+ * An optional circuit breaker per resolved host:port stops requests to unreachable agents: after
+ * "circuit_breaker_threshold" consecutive host failures (no connection or non-2xx response), requests resolve to
+ * "circuit_open_status" without touching the network. Every "circuit_breaker_open_ms", one request probes the host
+ * again and closes the circuit if it succeeds.
+ *
+ * When the owning action is destroyed, requests in flight are interrupted by shutting their sockets down and no new
+ * ones are sent, so destruction does not wait for "request_timeout_ms".
+ *
  * Config parameters:
- *     "host"            [string] request host address
- *     "port"            [int] request port
- *     "execute_path"    [string] request path for starting execution, e.g., <host>:<port></execute/path>
- *     "get_status_path" [string] request path for getting execution status, e.g., <host>:<port></status/path>
+ *     "host"                    [string] request host address
+ *     "port"                    [int] request port
+ *     "execute_path"            [string] request path for starting execution, e.g., <host>:<port></execute/path>
+ *     "get_status_path"         [string] request path for getting execution status, e.g., <host>:<port></status/path>
+ *     "coalesce_requests"       [bool][default: false] share one in-flight request among identical requests
+ *     "coalescing_cache_ttl_ms" [uint32_t][default: 0] if coalescing, reuse a response for this long after completion
+ *     "poll_backoff_initial_ms" [uint32_t][default: 0] first status poll delay when no hint is given; 0 disables backoff
+ *     "poll_backoff_max_ms"     [uint32_t][default: 10000] status poll delay cap when backing off
+ *     "hedge_status_requests"   [bool][default: false] send a backup status request when the first one is slow
+ *     "hedging_percentile"      [float][default: 0.95] latency percentile after which the backup request is sent
+ *     "max_hedged_requests"     [uint32_t][default: 4] hedged requests in flight, i.e., hedging worker threads
+ *     "circuit_breaker_threshold" [uint32_t][default: 0] consecutive host failures opening the circuit; 0 disables it
+ *     "circuit_breaker_open_ms"   [uint32_t][default: 5000] time before an open circuit lets a probe request through
+ *     "circuit_open_status"       [string][default: "ERROR"] SUCCESS, FAILURE, or ERROR while the circuit is open
+ *     "request_timeout_ms"        [uint32_t][default: 5000] connection, read, and write timeout of each request
  */
 class HttpGetAction : public IActionImpl
 {
     static constexpr const char* MODULE_TAG{"HttpGetAction"};
 
 public:
+    /// @brief agent response to an execute or status request
+    struct Response
+    {
+        ActionExecutionStatus status;
+        std::optional<std::chrono::milliseconds> retryAfter; // polling hint; only meaningful for IN_PROGRESS
+        bool hostFailure{false};    // the agent could not be reached or replied with a non-2xx status code
+        bool shortCircuited{false}; // no request was sent since the host circuit is open
+    };
+
     HttpGetAction(nlohmann::json const config)
         : m_host(config.at("host"))
         , m_port(config.at("port"))
         , m_executePath(config.at("execute_path"))
         , m_getStatusPath(config.at("get_status_path"))
+        , m_pollBackoffInitial(config.contains("poll_backoff_initial_ms")
+                                   ? config.at("poll_backoff_initial_ms").get<uint32_t>()
+                                   : 0U)
+        , m_pollBackoffMax(config.contains("poll_backoff_max_ms") ? config.at("poll_backoff_max_ms").get<uint32_t>()
+                                                                  : 10000U)
+        , m_circuitBreakerThreshold(config.contains("circuit_breaker_threshold")
+                                        ? config.at("circuit_breaker_threshold").get<uint32_t>()
+                                        : 0U)
+        , m_circuitBreakerOpenDuration(config.contains("circuit_breaker_open_ms")
+                                           ? config.at("circuit_breaker_open_ms").get<uint32_t>()
+                                           : 5000U)
+        , m_circuitOpenStatus(parseCircuitOpenStatus(config))
+        , m_requestTimeout(config.contains("request_timeout_ms") ? config.at("request_timeout_ms").get<uint32_t>()
+                                                                 : 5000U)
     {
+        if (config.contains("coalesce_requests") && config.at("coalesce_requests").get<bool>())
+        {
+            const auto cacheTtlMs =
+                config.contains("coalescing_cache_ttl_ms") ? config.at("coalescing_cache_ttl_ms").get<uint32_t>() : 0U;
+            m_coalescer =
+                std::make_unique<RequestCoalescer<Response>>(std::chrono::milliseconds(cacheTtlMs));
+        }
+        if (config.contains("hedge_status_requests") && config.at("hedge_status_requests").get<bool>())
+        {
+            m_latencyTracker = std::make_shared<LatencyTracker>();
+            m_hedgingPercentile =
+                config.contains("hedging_percentile") ? config.at("hedging_percentile").get<double>() : 0.95;
+            const auto maxHedgedRequests =
+                config.contains("max_hedged_requests") ? config.at("max_hedged_requests").get<uint32_t>() : 4U;
+            for (uint32_t i = 0U; i < maxHedgedRequests; ++i)
+            {
+                m_hedgingWorkers.emplace_back([this]() { runHedgingWorker(); });
+            }
+        }
     }
 
+    ~HttpGetAction() override;
+
     std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
     {
         return [token, this]() -> ActionExecutionStatus {
@@ -66,80 +156,196 @@ public:
             auto getStatusPath = m_getStatusPath.get(token);
 
             auto const actionId = host + std::to_string(port) + executePath;
-            bool const isInExecution = std::find(m_inExec.begin(), m_inExec.end(), actionId) != m_inExec.end();
-
-            ActionExecutionStatus retStatus{ActionExecutionStatus::NOT_STARTED};
-            if (isInExecution)
+            bool isInExecution{false};
             {
-                retStatus = request(host, port, getStatusPath);
-                if (retStatus._value != ActionExecutionStatus::IN_PROGRESS)
-                {
-                    m_inExec.remove(actionId);
-                }
+                // tracked while the request is in flight, so that `cancel` can tell it to forget the execution
+                std::lock_guard<std::mutex> lk(m_inExecMtx);
+                const auto [it, isInserted] = m_inExec.try_emplace(actionId);
+                isInExecution = !isInserted;
+                it->second.isRequestInFlight = true;
             }
-            else
+
+            const auto response = isInExecution ? coalescedRequest(host, port, getStatusPath, true)
+                                                : coalescedRequest(host, port, executePath, false);
             {
-                retStatus = request(host, port, executePath);
-                if (retStatus == +ActionExecutionStatus::IN_PROGRESS)
+                const bool isStillInExecution = response.status == +ActionExecutionStatus::IN_PROGRESS &&
+                                                (isInExecution || !response.shortCircuited);
+                std::lock_guard<std::mutex> lk(m_inExecMtx);
+                if (const auto it = m_inExec.find(actionId); it != m_inExec.end())
                 {
-                    m_inExec.push_back(actionId);
+                    if (it->second.isCancelled || !isStillInExecution)
+                    {
+                        m_inExec.erase(it);
+                    }
+                    else
+                    {
+                        it->second.isRequestInFlight = false;
+                    }
                 }
             }
-            return retStatus;
+            updatePollSchedule(token.get(), response);
+            return response.status;
         };
     }
 
-private:
-    ActionExecutionStatus request(std::string const& host, int port, std::string const& path)
+    std::optional<std::string> getConcurrencyKey(Token::ConstSharedPtr const& token) override
     {
-        httplib::Client client(host, port);
-        httplib::Result res = client.Get(path);
-
-        std::stringstream logMsg;
-        logMsg << "HttpGetAction :: requesting @ " << host << ":" << port << path << " ... ";
+        return m_host.get(token) + ":" + std::to_string(m_port.get(token));
+    }
 
-        ActionExecutionStatus retStatus(ActionExecutionStatus::NOT_STARTED);
-        if (!res)
-        {
-            auto err = res.error();
-            logMsg << "ERROR; HTTP error: " << httplib::to_string(err) << "\n";
-            retStatus = ActionExecutionStatus::ERROR;
-            LOG(ERROR) << logMsg.str();
-        }
-        else if (res->status < 200 && res->status >= 300)
-        {
-            logMsg << "ERROR; response status code: " << res->status << "\n";
-            retStatus = ActionExecutionStatus::ERROR;
-            LOG(ERROR) << logMsg.str();
-        }
-        else
+    void cancel(Token::ConstSharedPtr const& token) override
+    {
         {
-            better_enums::optional<ActionExecutionStatus> maybeRetStatus =
-                ActionExecutionStatus::_from_string_nothrow(res->body.c_str());
-
-            if (maybeRetStatus)
+            auto const actionId = m_host.get(token) + std::to_string(m_port.get(token)) + m_executePath.get(token);
+            std::lock_guard<std::mutex> lk(m_inExecMtx);
+            const auto it = m_inExec.find(actionId);
+            if (it != m_inExec.end() && it->second.isRequestInFlight)
             {
-                logMsg << "Received " << res->body << "; response status code: " << res->status << "\n";
-                retStatus = maybeRetStatus.value();
-                LOG(DEBUG) << logMsg.str();
+                it->second.isCancelled = true; // forgotten by the callable once the request returns
             }
-            else
+            else if (it != m_inExec.end())
             {
-                logMsg << "ERROR; response status code: " << res->status
-                       << "; unrecognized response body: " << res->body << "\n";
-                retStatus = ActionExecutionStatus::ERROR;
-                LOG(ERROR) << logMsg.str();
+                m_inExec.erase(it);
             }
         }
-        return retStatus;
+        std::lock_guard<std::mutex> lk(m_pollSchedulesMtx);
+        m_pollSchedules.erase(token.get());
+    }
+
+    void stop() override;
+
+    std::optional<TimingWheel::Clock::time_point> getNextExecutionTime(Token::ConstSharedPtr const& token) override
+    {
+        std::lock_guard<std::mutex> lk(m_pollSchedulesMtx);
+        const auto it = m_pollSchedules.find(token.get());
+        return it != m_pollSchedules.end() ? it->second.nextPoll : std::nullopt;
+    }
+
+    /// @return number of tracked executions: in progress remotely, or with a request in flight
+    std::size_t getNumberTrackedExecutions()
+    {
+        std::lock_guard<std::mutex> lk(m_inExecMtx);
+        return m_inExec.size();
+    }
+
+private:
+    struct PollSchedule
+    {
+        std::optional<TimingWheel::Clock::time_point> nextPoll;
+        std::chrono::milliseconds backoff{0};
+    };
+
+    /// @brief status request raced against a backup request, see `hedgedRequest`
+    struct HedgedRequest
+    {
+        std::string host;
+        int port;
+        std::string path;
+        std::chrono::steady_clock::time_point hedgingTime; // the backup request is sent if no response arrived by then
+        std::shared_ptr<httplib::Client> primaryClient;
+        std::shared_ptr<httplib::Client> backupClient;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool isPrimaryDone{false};
+        bool isPrimaryCancelled{false};
+        bool isBackupSent{false};
+        bool isBackupDone{false};
+        bool isBackupCancelled{false};
+        std::optional<Response> backupResponse;
+    };
+
+    /// @brief `request`, shared with identical concurrent requests if coalescing is enabled
+    /// @param idempotent whether the request may be hedged
+    Response coalescedRequest(std::string const& host, int port, std::string const& path, bool idempotent)
+    {
+        const auto send = [&]() {
+            return circuitBreakerRequest(host, port, [&]() {
+                if (!m_latencyTracker)
+                {
+                    return request(host, port, path, m_requestTimeout);
+                }
+                return idempotent ? hedgedRequest(host, port, path)
+                                  : trackedRequest(m_latencyTracker, host, port, path, m_requestTimeout);
+            });
+        };
+
+        if (!m_coalescer)
+        {
+            return send();
+        }
+        return m_coalescer->execute(host + ":" + std::to_string(port) + path, send);
     }
 
+    /// @brief run `sendRequest` unless the host circuit is open
+    Response circuitBreakerRequest(std::string const& host, int port, std::function<Response()> const& sendRequest);
+
+    static ActionExecutionStatus parseCircuitOpenStatus(nlohmann::json const& config);
+
+    /// @brief send a backup request if the first one takes longer than the host's latency percentile
+    Response hedgedRequest(std::string const& host, int port, std::string const& path);
+
+    /// @brief send the backup requests of queued hedged requests whose primary request is late
+    void runHedgingWorker();
+
+    void sendBackupRequest(HedgedRequest& hedged);
+
+    /// @brief compute when the status of an in progress action should be polled next
+    void updatePollSchedule(Token const* token, Response const& response);
+
+    /// @param timeout connection, read, and write timeout
+    Response request(std::string const& host, int port, std::string const& path, std::chrono::milliseconds timeout);
+
+    /// @brief `request` with a client for `host`:`port`, which other threads may `stop()`
+    Response request(httplib::Client& client, std::string const& host, int port, std::string const& path);
+
+    /// @brief `request`, recording its latency for the host
+    Response trackedRequest(std::shared_ptr<LatencyTracker> const& tracker, std::string const& host, int port,
+                            std::string const& path, std::chrono::milliseconds timeout);
+
     const ConfigParameter<std::string> m_host;
     const ConfigParameter<int> m_port;
     const ConfigParameter<std::string> m_executePath;
     const ConfigParameter<std::string> m_getStatusPath;
 
-    std::list<std::string> m_inExec; // to keep track of actions in execution so we know which request type to send
+    struct Execution
+    {
+        bool isRequestInFlight{false};
+        bool isCancelled{false}; // cancelled while a request was in flight
+    };
+
+    // to keep track of actions in execution so we know which request type to send
+    std::unordered_map<std::string, Execution> m_inExec;
+    std::mutex m_inExecMtx;
+
+    std::unique_ptr<RequestCoalescer<Response>> m_coalescer; // nullptr if coalescing is disabled
+
+    const std::chrono::milliseconds m_pollBackoffInitial;
+    const std::chrono::milliseconds m_pollBackoffMax;
+    std::unordered_map<Token const*, PollSchedule> m_pollSchedules; // only for actions in progress
+    std::mutex m_pollSchedulesMtx;
+
+    std::shared_ptr<LatencyTracker> m_latencyTracker; // nullptr if hedging is disabled
+    double m_hedgingPercentile{0.95};
+    std::deque<std::shared_ptr<HedgedRequest>> m_hedgingQueue; // waiting for a worker
+    std::size_t m_hedgesInFlight{0U};                          // queued or handled by a worker
+    bool m_isHedgingStopping{false};
+    std::mutex m_hedgingMtx;
+    std::condition_variable m_hedgingCv;
+    std::vector<std::thread> m_hedgingWorkers; // joined on destruction; empty if hedging is disabled
+
+    const uint32_t m_circuitBreakerThreshold; // 0 if circuit breaking is disabled
+    const std::chrono::milliseconds m_circuitBreakerOpenDuration;
+    const ActionExecutionStatus m_circuitOpenStatus;
+    std::unordered_map<std::string, CircuitBreaker> m_circuitBreakers; // key: <host>:<port>
+    std::mutex m_circuitBreakersMtx;
+
+    const std::chrono::milliseconds m_requestTimeout;
+
+    std::unordered_set<httplib::Client*> m_activeClients; // requests in flight, interrupted by `stop`
+    bool m_isStopping{false};
+    std::mutex m_activeClientsMtx;
+    std::condition_variable m_activeClientsCv;
 };
 
 } // namespace bnet
@@ -22,10 +22,8 @@
 
 #include <behavior_net/ActionRegistry.hpp>
 #include <chrono>
-#include <mutex>
 #include <random>
 #include <string>
-#include <unordered_map>
 
 namespace capybot
 {
@@ -35,6 +33,9 @@ namespace bnet
 /**
  * @brief This action simply holds the token for a certain amount of time
  *
+ * The token is registered once in the thread pool timing wheel and resolved when the timer expires; no task is
+ * executed for it while waiting.
+ *
  * Config parameters:
  *     "duration_ms"  [uint32_t] how long to hold the token for
  *     "failure_rate" [float][range: 0.0, 1.0][default: 0.0] rate in which the action should result in failure
@@ -54,7 +55,7 @@ public:
     {
     }
 
-    std::function<ActionExecutionStatus()> createCallable(Token::ConstSharedPtr token) override
+    std::optional<ActionTimedResult> createTimedResult(Token::ConstSharedPtr const& token) override
     {
         float failureRate = m_failureRate.get(token);
         float errorRate = m_errorRate.get(token);
@@ -65,24 +66,8 @@ public:
 
         const auto durationMs = m_durationMs.get(token);
 
-        return [this, token, durationMs, result]() -> ActionExecutionStatus {
-            const auto now = std::chrono::system_clock::now();
-
-            std::unique_lock<std::mutex> lk(m_mtx);
-
-            if (m_tokenIdToFinishTime.find(token.get()) == m_tokenIdToFinishTime.end()) // new timer
-            {
-                m_tokenIdToFinishTime[token.get()] = now + std::chrono::milliseconds(durationMs);
-            }
-
-            if (now > m_tokenIdToFinishTime[token.get()]) // timer is done
-            {
-                m_tokenIdToFinishTime.erase(token.get());
-                return result;
-            }
-
-            return ActionExecutionStatus::IN_PROGRESS; // timer is not done
-        };
+        return ActionTimedResult{.deadline = TimingWheel::Clock::now() + std::chrono::milliseconds(durationMs),
+                                 .status = result};
     }
 
 private:
@@ -90,9 +75,6 @@ private:
     const ConfigParameter<float> m_failureRate;
     const ConfigParameter<float> m_errorRate;
 
-    std::unordered_map<const Token*, std::chrono::time_point<std::chrono::system_clock>> m_tokenIdToFinishTime;
-    std::mutex m_mtx;
-
     std::random_device m_rd;
     std::mt19937 m_gen;
 };
@@ -18,7 +18,21 @@
 #include <3rd_party/nlohmann/json.hpp>
 #include <behavior_net/Config.hpp>
 #include <behavior_net/server_impl/HttpServer.hpp>
+#include <utils/Gzip.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <iomanip>
 #include <memory>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 namespace capybot
 {
@@ -36,27 +50,299 @@ bool validateHttpServerConfig(nlohmann::json const& netConfig, std::vector<std::
     auto serverConfig = getValueAtPath<nlohmann::json>(netConfig, {"controller", "http_server"}, errorMessages).value();
 
     // check expected info exists in expected format
-    std::ignore = getValueAtKey<std::string>(serverConfig, "address", errorMessages);
-    std::ignore = getValueAtKey<int>(serverConfig, "port", errorMessages);
+    const bool hasUnixSocket{serverConfig.contains("unix_socket_path")};
+    if (!hasUnixSocket || serverConfig.contains("address") || serverConfig.contains("port"))
+    {
+        std::ignore = getValueAtKey<std::string>(serverConfig, "address", errorMessages);
+        std::ignore = getValueAtKey<int>(serverConfig, "port", errorMessages);
+    }
+    if (hasUnixSocket)
+    {
+        const auto path = getValueAtKey<std::string>(serverConfig, "unix_socket_path", errorMessages);
+        if (path.has_value() && (path->empty() || path->size() >= sizeof(sockaddr_un::sun_path)))
+        {
+            errorMessages.push_back("Invalid `unix_socket_path` (expected a non-empty path shorter than " +
+                                    std::to_string(sizeof(sockaddr_un::sun_path)) + " characters) for http_server.");
+        }
+    }
+    if (serverConfig.contains("unix_socket_mode"))
+    {
+        const auto mode = getValueAtKey<std::string>(serverConfig, "unix_socket_mode", errorMessages);
+        if (mode.has_value() &&
+            (mode->empty() || mode->size() > 4U || mode->find_first_not_of("01234567") != std::string::npos))
+        {
+            errorMessages.push_back("Invalid `unix_socket_mode` (expected octal permissions, e.g. \"0660\") for "
+                                    "http_server.");
+        }
+    }
+    for (auto&& key : {"gzip_config", "tcp_nodelay"})
+    {
+        if (serverConfig.contains(key))
+        {
+            std::ignore = getValueAtKey<bool>(serverConfig, key, errorMessages);
+        }
+    }
+    for (auto&& key : {"thread_pool_size", "max_streams", "keep_alive_max_count", "keep_alive_timeout_s",
+                       "read_timeout_ms", "write_timeout_ms", "payload_max_length"})
+    {
+        if (serverConfig.contains(key) &&
+            (!serverConfig.at(key).is_number_unsigned() || serverConfig.at(key).get<uint64_t>() == 0U))
+        {
+            errorMessages.push_back(std::string("Invalid `") + key +
+                                    "` (expected a positive integer) for http_server.");
+        }
+    }
+    if (serverConfig.contains("gzip_min_size") && !serverConfig.at("gzip_min_size").is_number_unsigned())
+    {
+        errorMessages.push_back("Invalid `gzip_min_size` (expected a non-negative integer) for http_server.");
+    }
+    if (serverConfig.contains("gzip_level") &&
+        (!serverConfig.at("gzip_level").is_number_integer() || serverConfig.at("gzip_level").get<int>() < 1 ||
+         serverConfig.at("gzip_level").get<int>() > 9))
+    {
+        errorMessages.push_back("Invalid `gzip_level` (expected an integer in [1, 9]) for http_server.");
+    }
 
     return errorMessages.empty();
 }
 
 REGISTER_NET_CONFIG_VALIDATOR(&validateHttpServerConfig, "HttpServerConfigValidator");
 
+namespace
+{
+template <typename T>
+std::optional<T> getOptionalParameter(nlohmann::json const& config, std::string const& key)
+{
+    return config.contains(key) ? std::optional(config.at(key).get<T>()) : std::nullopt;
+}
+
+std::string computeEtag(std::string const& body, std::string_view suffix = "")
+{
+    std::stringstream ss;
+    ss << '"' << std::hex << std::setfill('0') << std::setw(16) << std::hash<std::string>{}(body) << '-' << body.size()
+       << suffix << '"';
+    return ss.str();
+}
+
+/// @return nullopt unless `str` is a decimal uint64_t, with no sign or other characters
+std::optional<uint64_t> parseUint64(std::string_view str)
+{
+    uint64_t value{0U};
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end != str.data() + str.size())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string_view trim(std::string_view str)
+{
+    const auto begin = str.find_first_not_of(" \t");
+    if (begin == std::string_view::npos)
+    {
+        return {};
+    }
+    const auto end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1U);
+}
+
+/// @brief call `func` for each element of a comma separated header value, trimmed
+template <typename FuncT>
+void forEachListElement(std::string_view headerValue, FuncT&& func)
+{
+    while (!headerValue.empty())
+    {
+        const auto comma = headerValue.find(',');
+        func(trim(headerValue.substr(0, comma)));
+        headerValue = comma == std::string_view::npos ? std::string_view{} : headerValue.substr(comma + 1U);
+    }
+}
+
+/// @brief If-None-Match uses weak comparison, i.e., the `W/` prefix is ignored
+bool matchesIfNoneMatch(const httplib::Request& req, std::string_view etag)
+{
+    bool matches{false};
+    forEachListElement(req.get_header_value("If-None-Match"), [&](std::string_view candidate) {
+        if (candidate.starts_with("W/"))
+        {
+            candidate.remove_prefix(2U);
+        }
+        matches |= candidate == "*" || candidate == etag;
+    });
+    return matches;
+}
+
+/// @return whether `coding` (e.g., "gzip") is accepted per the Accept-Encoding header; `q=0` refuses it
+bool acceptsEncoding(const httplib::Request& req, std::string_view coding)
+{
+    bool accepts{false};
+    forEachListElement(req.get_header_value("Accept-Encoding"), [&](std::string_view element) {
+        const auto paramsPos = element.find(';');
+        const auto name = trim(element.substr(0, paramsPos));
+        if (name != coding && name != "*")
+        {
+            return;
+        }
+        double quality{1.0};
+        if (paramsPos != std::string_view::npos)
+        {
+            const auto params = trim(element.substr(paramsPos + 1U));
+            if (params.starts_with("q="))
+            {
+                quality = std::strtod(std::string(params.substr(2U)).c_str(), nullptr);
+            }
+        }
+        accepts |= quality > 0.0;
+    });
+    return accepts;
+}
+} // namespace
+
 HttpServer::HttpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs)
     : m_controllerCbs(controllerCbs)
-    , m_addr(config.at("address").get<std::string>())
-    , m_port(config.at("port").get<int>())
+    , m_gzipConfig(config.contains("gzip_config") ? config.at("gzip_config").get<bool>() : true)
+    , m_gzipMinSize(getOptionalParameter<std::size_t>(config, "gzip_min_size").value_or(DEFAULT_GZIP_MIN_SIZE))
+    , m_gzipLevel(getOptionalParameter<int>(config, "gzip_level").value_or(DEFAULT_GZIP_LEVEL))
+    , m_threadPoolSize(getOptionalParameter<uint32_t>(config, "thread_pool_size"))
+    , m_maxStreams(getOptionalParameter<uint32_t>(config, "max_streams")
+                       .value_or(std::max(1U, m_threadPoolSize.value_or(CPPHTTPLIB_THREAD_POOL_COUNT) / 2U)))
+    , m_keepAliveMaxCount(getOptionalParameter<uint32_t>(config, "keep_alive_max_count"))
+    , m_keepAliveTimeoutS(getOptionalParameter<uint32_t>(config, "keep_alive_timeout_s"))
+    , m_readTimeoutMs(getOptionalParameter<uint32_t>(config, "read_timeout_ms"))
+    , m_writeTimeoutMs(getOptionalParameter<uint32_t>(config, "write_timeout_ms"))
+    , m_payloadMaxLength(getOptionalParameter<std::size_t>(config, "payload_max_length"))
+    , m_tcpNoDelay(getOptionalParameter<bool>(config, "tcp_nodelay").value_or(true))
 {
-    LOG(INFO) << "Running @ http://" << m_addr << ":" << m_port << log::endl;
+    if (config.contains("address"))
+    {
+        auto& listener = m_listeners.emplace_back();
+        listener.host = config.at("address").get<std::string>();
+        listener.port = config.at("port").get<int>();
+        listener.isUnixSocket = false;
+        LOG(INFO) << "Running @ http://" << listener.host << ":" << listener.port << log::endl;
+    }
+    if (config.contains("unix_socket_path"))
+    {
+        auto& listener = m_listeners.emplace_back();
+        listener.host = config.at("unix_socket_path").get<std::string>();
+        listener.port = 80; // unused, but httplib looks up the bound port of TCP sockets when it is 0
+        listener.isUnixSocket = true;
+        LOG(INFO) << "Running @ unix:" << listener.host << log::endl;
+    }
+    if (config.contains("unix_socket_mode"))
+    {
+        const auto mode = config.at("unix_socket_mode").get<std::string>();
+        m_unixSocketMode = static_cast<mode_t>(std::stoul(mode, nullptr, 8));
+    }
 }
 
-void HttpServer::runServer()
+void HttpServer::start()
 {
-    LOG(DEBUG) << "runServer: starting HTTP server..." << log::endl;
-    httplib::Server server;
-    m_server = &server;
+    auto config = m_controllerCbs.getNetConfig().dump();
+    const bool compressConfig{m_gzipConfig && config.size() >= m_gzipMinSize};
+    m_configCache = createCachedBody(std::move(config), compressConfig);
+
+    for (auto&& listener : m_listeners)
+    {
+        configureServer(listener.server, listener.isUnixSocket);
+        if (bind(listener)) // bind synchronously, so the server accepts connections once `start` returns
+        {
+            listener.thread = std::thread([&listener] {
+                listener.server.listen_after_bind();
+                listener.isDone.store(true);
+                LOG(DEBUG) << "Stopped listening @ " << listener.host << log::endl;
+            });
+        }
+    }
+}
+
+void HttpServer::stop()
+{
+    m_stopping.store(true);
+    for (auto&& listener : m_listeners)
+    {
+        if (!listener.thread.joinable())
+        {
+            continue;
+        }
+        // `httplib::Server::stop` is a no-op until the accept loop runs
+        while (!listener.server.is_running() && !listener.isDone.load())
+        {
+            std::this_thread::yield();
+        }
+        listener.server.stop();
+        listener.thread.join();
+        if (listener.isUnixSocket)
+        {
+            ::unlink(listener.host.c_str());
+        }
+    }
+}
+
+bool HttpServer::bind(Listener& listener)
+{
+    if (listener.isUnixSocket)
+    {
+        // a socket file left behind by a previous run would make bind fail; never remove anything but a socket
+        struct stat fileStat;
+        if (::lstat(listener.host.c_str(), &fileStat) == 0)
+        {
+            if (!S_ISSOCK(fileStat.st_mode))
+            {
+                LOG(ERROR) << "Not listening @ " << listener.host << ": file exists and is not a socket." << log::endl;
+                return false;
+            }
+            ::unlink(listener.host.c_str());
+        }
+    }
+
+    if (!listener.server.bind_to_port(listener.host, listener.port))
+    {
+        LOG(ERROR) << "Failed to bind @ " << listener.host << ":" << listener.port << ": " << std::strerror(errno)
+                   << log::endl;
+        return false;
+    }
+    if (listener.isUnixSocket && m_unixSocketMode.has_value() &&
+        ::chmod(listener.host.c_str(), m_unixSocketMode.value()) != 0)
+    {
+        LOG(ERROR) << "Failed to set the permissions of " << listener.host << ": " << std::strerror(errno)
+                   << log::endl;
+    }
+    return true;
+}
+
+void HttpServer::configureServer(httplib::Server& server, bool isUnixSocket)
+{
+    if (isUnixSocket)
+    {
+        server.set_address_family(AF_UNIX);
+    }
+    if (m_threadPoolSize.has_value())
+    {
+        server.new_task_queue = [size = m_threadPoolSize.value()] { return new httplib::ThreadPool(size); };
+    }
+    if (m_keepAliveMaxCount.has_value())
+    {
+        server.set_keep_alive_max_count(m_keepAliveMaxCount.value());
+    }
+    if (m_keepAliveTimeoutS.has_value())
+    {
+        server.set_keep_alive_timeout(m_keepAliveTimeoutS.value());
+    }
+    if (m_readTimeoutMs.has_value())
+    {
+        server.set_read_timeout(std::chrono::milliseconds(m_readTimeoutMs.value()));
+    }
+    if (m_writeTimeoutMs.has_value())
+    {
+        server.set_write_timeout(std::chrono::milliseconds(m_writeTimeoutMs.value()));
+    }
+    if (m_payloadMaxLength.has_value())
+    {
+        server.set_payload_max_length(m_payloadMaxLength.value());
+    }
+    server.set_tcp_nodelay(m_tcpNoDelay && !isUnixSocket);
 
     setCallbacks(server);
 
@@ -68,6 +354,18 @@ void HttpServer::runServer()
         {
             std::rethrow_exception(ep);
         }
+        catch (Exception& e)
+        {
+            if (e.type() == +ExceptionType::CAPACITY_EXCEEDED) // backpressure: the client should retry later
+            {
+                res.set_content(e.what(), "text/plain");
+                res.status = 429;
+                res.set_header("Retry-After", "1");
+                LOG(WARN) << "Request rejected, place is full: " << req.path << log::endl;
+                return;
+            }
+            snprintf(buf, sizeof(buf), fmt, e.what());
+        }
         catch (std::exception& e)
         {
             snprintf(buf, sizeof(buf), fmt, e.what());
@@ -90,9 +388,6 @@ void HttpServer::runServer()
 
         LOG(ERROR) << "Error caught while handling request: " << buf << log::endl;
     });
-
-    server.listen(m_addr, m_port);
-    LOG(DEBUG) << "runServer: exiting..." << log::endl;
 }
 
 void HttpServer::setCallbacks(httplib::Server& server)
@@ -101,21 +396,176 @@ void HttpServer::setCallbacks(httplib::Server& server)
         res.set_content("You have reached bnet::capybot::HttpServer.", "text/plain");
     });
     server.Post("/add_token", [this](const httplib::Request& req, httplib::Response& res) {
+        auto request = TokenRequest::parse(req.body);
+        m_controllerCbs.addToken(std::move(request.contentBlocks), request.placeId, request.ttl);
+    });
+    // body: array of `/add_token` payloads; response: per item results, see `toJson(BulkResults const&)`
+    server.Post("/add_tokens", [this](const httplib::Request& req, httplib::Response& res) {
         nlohmann::json payload = nlohmann::json::parse(req.body);
-        m_controllerCbs.addToken(payload.at("content_blocks"), payload.at("place_id").get<std::string>());
+        if (!payload.is_array())
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "/add_tokens: expected an array of tokens.");
+        }
+
+        // malformed items fail on their own; the rest are added in a single controller step
+        BulkResults results(payload.size());
+        std::vector<TokenRequest> requests;
+        std::vector<std::size_t> requestIndices;
+        requests.reserve(payload.size());
+        for (std::size_t i = 0; i < payload.size(); ++i)
+        {
+            try
+            {
+                requests.push_back(TokenRequest::fromJson(std::move(payload.at(i))));
+                requestIndices.push_back(i);
+            }
+            catch (std::exception const& e)
+            {
+                results.at(i) = std::string("invalid token: ") + e.what();
+            }
+        }
+        const auto addResults = m_controllerCbs.addTokens(std::move(requests));
+        for (std::size_t i = 0; i < addResults.size(); ++i)
+        {
+            results.at(requestIndices.at(i)) = addResults.at(i);
+        }
+        setJsonContent(toJson(results).dump(), req, res);
     });
     server.Get("/get_config", [this](const httplib::Request& req, httplib::Response& res) {
-        nlohmann::json marking = m_controllerCbs.getNetMarking();
-        res.set_content(marking.at("config").dump(), "application/json");
+        setCachedContent(m_configCache, "application/json", req, res);
     });
+    // `?since=<version>` returns only places changed after the given marking version; the current version is in the
+    // `X-Marking-Version` header
     server.Get("/get_marking", [this](const httplib::Request& req, httplib::Response& res) {
-        nlohmann::json marking = m_controllerCbs.getNetMarking();
-        res.set_content(marking.at("marking").dump(), "application/json");
+        std::optional<uint64_t> sinceVersion;
+        if (req.has_param("since"))
+        {
+            sinceVersion = parseUint64(req.get_param_value("since"));
+            if (!sinceVersion.has_value())
+            {
+                res.status = 400;
+                res.set_content("Invalid since (expected a marking version).", "text/plain");
+                return;
+            }
+        }
+        nlohmann::json marking = m_controllerCbs.getNetMarking(sinceVersion);
+        res.set_header("X-Marking-Version", std::to_string(marking.at("version").get<uint64_t>()));
+        setJsonContent(marking.at("marking").dump(), req, res);
+    });
+    // server-sent events; one `marking` event per epoch in which the number of tokens of some place changed, carrying
+    // only those places, see `Controller::getMarkingUpdates`. The first event carries the whole marking, unless the
+    // client resumes with the `Last-Event-ID` of an event still in the controller history. 503 past "max_streams".
+    server.Get("/marking_stream", [this](const httplib::Request& req, httplib::Response& res) {
+        auto sequence = std::make_shared<std::optional<uint64_t>>();
+        if (req.has_header("Last-Event-ID"))
+        {
+            *sequence = parseUint64(req.get_header_value("Last-Event-ID"));
+            if (!sequence->has_value())
+            {
+                res.status = 400;
+                res.set_content("Invalid Last-Event-ID (expected a sequence number).", "text/plain");
+                return;
+            }
+        }
+        // each stream holds a worker thread until the client disconnects; keep workers for the other endpoints
+        if (m_openStreams.fetch_add(1U) >= m_maxStreams)
+        {
+            m_openStreams.fetch_sub(1U);
+            res.status = 503;
+            res.set_header("Retry-After", "1");
+            res.set_content("Too many open marking streams.", "text/plain");
+            return;
+        }
+        res.set_header("Cache-Control", "no-cache");
+        auto provider = [this, sequence](size_t, httplib::DataSink& sink) {
+            if (m_stopping.load())
+            {
+                return false;
+            }
+            const auto updates = m_controllerCbs.getMarkingUpdates(*sequence, STREAM_HEARTBEAT_PERIOD);
+            std::string event;
+            if (updates.at("marking").empty() && !updates.at("full").get<bool>())
+            {
+                event = ": heartbeat\n\n"; // detects closed connections
+            }
+            else
+            {
+                *sequence = updates.at("seq").get<uint64_t>();
+                event = "id: " + std::to_string(sequence->value()) + "\nevent: marking\ndata: " + updates.dump() +
+                        "\n\n";
+            }
+            return sink.write(event.data(), event.size());
+        };
+        res.set_chunked_content_provider("text/event-stream", std::move(provider),
+                                         [this](bool) { m_openStreams.fetch_sub(1U); });
     });
     server.Post("/trigger_manual_transition/(.*)", [this](const httplib::Request& req, httplib::Response& res) {
         auto id = req.matches[1];
         m_controllerCbs.triggerManualTransition(id.str());
     });
+    // body: array of transition ids, triggered in order; response: per item results, see `toJson(BulkResults const&)`
+    server.Post("/trigger_manual_transitions", [this](const httplib::Request& req, httplib::Response& res) {
+        nlohmann::json payload = nlohmann::json::parse(req.body);
+        const auto ids = payload.get<std::vector<std::string>>();
+        setJsonContent(toJson(m_controllerCbs.triggerManualTransitions(ids)).dump(), req, res);
+    });
+}
+
+HttpServer::CachedBody HttpServer::createCachedBody(std::string body, bool compress)
+{
+    CachedBody cached;
+    cached.etag = computeEtag(body);
+    if (compress)
+    {
+        cached.gzipBody = std::make_shared<const std::string>(gzip::compress(body));
+        cached.gzipEtag = computeEtag(body, "-gzip");
+    }
+    cached.body = std::make_shared<const std::string>(std::move(body));
+    return cached;
+}
+
+void HttpServer::setCachedContent(CachedBody const& cached, std::string const& contentType,
+                                  const httplib::Request& req, httplib::Response& res)
+{
+    const bool useGzip = cached.gzipBody && acceptsEncoding(req, "gzip");
+    const auto& etag = useGzip ? cached.gzipEtag : cached.etag;
+    res.set_header("ETag", etag);
+    res.set_header("Cache-Control", "no-cache"); // always revalidate, the ETag makes it cheap
+    if (cached.gzipBody)
+    {
+        res.set_header("Vary", "Accept-Encoding");
+    }
+
+    if (matchesIfNoneMatch(req, etag))
+    {
+        res.status = 304;
+        return;
+    }
+
+    // serve the shared bytes, no per request copy
+    auto body = useGzip ? cached.gzipBody : cached.body;
+    if (useGzip)
+    {
+        res.set_header("Content-Encoding", "gzip");
+    }
+    res.set_content_provider(body->size(), contentType,
+                             [body](size_t offset, size_t length, httplib::DataSink& sink) {
+                                 return sink.write(body->data() + offset, length);
+                             });
+}
+
+void HttpServer::setJsonContent(std::string body, const httplib::Request& req, httplib::Response& res) const
+{
+    if (body.size() >= m_gzipMinSize)
+    {
+        res.set_header("Vary", "Accept-Encoding");
+        if (acceptsEncoding(req, "gzip"))
+        {
+            body = gzip::compress(body, m_gzipLevel);
+            res.set_header("Content-Encoding", "gzip");
+        }
+    }
+    res.set_content(std::move(body), "application/json");
 }
 
 } // namespace bnet
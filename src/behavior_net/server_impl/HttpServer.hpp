@@ -18,7 +18,16 @@
 #pragma once
 
 #include <behavior_net/Controller.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <list>
 #include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <sys/types.h>
 
 namespace capybot
 {
@@ -34,32 +43,84 @@ public:
 
     ~HttpServer() { stop(); }
 
-    void start() override
-    {
-        m_executionThread = std::thread([this] { runServer(); });
-    }
+    void start() override;
 
-    void stop() override
-    {
-        m_server->stop();
-        if (m_executionThread.joinable())
-        {
-            m_executionThread.join();
-        }
-    }
+    void stop() override;
 
 private:
-    void runServer();
+    /// @brief one httplib server per listening socket, all serving the same endpoints
+    struct Listener
+    {
+        std::string host; // address, or socket path for Unix domain sockets
+        int port;         // unused for Unix domain sockets
+        bool isUnixSocket;
+        httplib::Server server;
+        std::thread thread;
+        std::atomic_bool isDone{false};
+    };
+
+    /// @return whether `listener` is bound and ready to listen; errors are logged
+    bool bind(Listener& listener);
+
+    void configureServer(httplib::Server& server, bool isUnixSocket);
 
     void setCallbacks(httplib::Server& server);
 
-    httplib::Server* m_server{nullptr};
+    /// @brief immutable response body, serialized once, with strong ETags for its identity and gzip representations
+    struct CachedBody
+    {
+        std::shared_ptr<const std::string> body;
+        std::string etag;
+        std::shared_ptr<const std::string> gzipBody; // nullptr if not compressed
+        std::string gzipEtag;
+    };
+
+    static CachedBody createCachedBody(std::string body, bool compress);
+
+    /// @brief serve `cached` with conditional request (`If-None-Match`) and `Accept-Encoding: gzip` support
+    static void setCachedContent(CachedBody const& cached, std::string const& contentType, const httplib::Request& req,
+                                 httplib::Response& res);
+
+    /// @brief set a dynamic json response, gzip compressed if the client accepts it and it has at least
+    /// "gzip_min_size" bytes. For all responses that can be large, e.g., markings and token listings.
+    void setJsonContent(std::string body, const httplib::Request& req, httplib::Response& res) const;
+
+    static constexpr std::chrono::seconds STREAM_HEARTBEAT_PERIOD{1};
+    static constexpr std::size_t DEFAULT_GZIP_MIN_SIZE{1024U};
+    static constexpr int DEFAULT_GZIP_LEVEL{1};
+
+    std::atomic_bool m_stopping{false}; // ends open streams
     ControllerCallbacks m_controllerCbs;
 
-    std::string m_addr;
-    int m_port;
+    // "address" [string] and "port" [int], optional if "unix_socket_path" is set
+    // "unix_socket_path" [string] additionally listen on this Unix domain socket, for clients on the same host
+    // "unix_socket_mode" [string] octal permissions of the socket file, e.g. "0660"; only the umask applies if not set
+    std::optional<mode_t> m_unixSocketMode;
+    std::list<Listener> m_listeners;
+    bool m_gzipConfig; // "gzip_config" [bool][default: true] keep a gzip variant of `/get_config`
+    // "gzip_min_size" [uint64_t][default: 1024] smaller responses are never compressed: the gain would not be worth the
+    // CPU time and the gzip overhead
+    std::size_t m_gzipMinSize;
+    // "gzip_level" [int][default: 1] compression level of dynamic responses, from 1 (fastest) to 9 (smallest); they are
+    // compressed on every request, unlike `/get_config`
+    int m_gzipLevel;
+
+    // Tuning; httplib defaults if not set. Each open `/marking_stream` holds a worker thread.
+    std::optional<uint32_t> m_threadPoolSize;      // "thread_pool_size" [uint32_t] request worker threads
+    // "max_streams" [uint32_t][default: half of the worker threads] open `/marking_stream`s, across listeners
+    uint32_t m_maxStreams;
+    std::atomic<uint32_t> m_openStreams{0U};
+    std::optional<uint32_t> m_keepAliveMaxCount;   // "keep_alive_max_count" [uint32_t] requests per connection
+    std::optional<uint32_t> m_keepAliveTimeoutS;   // "keep_alive_timeout_s" [uint32_t] max idle time of connections
+    std::optional<uint32_t> m_readTimeoutMs;       // "read_timeout_ms" [uint32_t]
+    std::optional<uint32_t> m_writeTimeoutMs;      // "write_timeout_ms" [uint32_t]
+    std::optional<std::size_t> m_payloadMaxLength; // "payload_max_length" [uint64_t] max request body bytes, else 413
+
+    // "tcp_nodelay" [bool][default: true] disable Nagle's algorithm; httplib writes headers and body separately, so
+    // with Nagle every keep-alive response waits for the client delayed ACK (~40ms)
+    bool m_tcpNoDelay;
 
-    std::thread m_executionThread;
+    CachedBody m_configCache; // the config never changes at runtime
 };
 
 } // namespace bnet
@@ -19,22 +19,36 @@
 #include <behavior_net/Controller.hpp>
 #include <behavior_net/Types.hpp>
 #include <behavior_net/server_impl/HttpServer.hpp>
+#include <behavior_net/server_impl/ShmServer.hpp>
+#include <behavior_net/server_impl/TcpServer.hpp>
 
 namespace capybot
 {
 namespace bnet
 {
 
-std::unique_ptr<IServer> IServer::create(nlohmann::json const& controllerConfig,
-                                         ControllerCallbacks const& controllerCbs)
+std::vector<std::unique_ptr<IServer>> IServer::create(nlohmann::json const& controllerConfig,
+                                                      ControllerCallbacks const& controllerCbs)
 {
+    std::vector<std::unique_ptr<IServer>> servers;
     if (controllerConfig.contains("http_server"))
     {
-        return std::make_unique<HttpServer>(controllerConfig.at("http_server"), controllerCbs);
+        servers.push_back(std::make_unique<HttpServer>(controllerConfig.at("http_server"), controllerCbs));
+    }
+    if (controllerConfig.contains("tcp_server"))
+    {
+        servers.push_back(std::make_unique<TcpServer>(controllerConfig.at("tcp_server"), controllerCbs));
+    }
+    if (controllerConfig.contains("shm_server"))
+    {
+        servers.push_back(std::make_unique<ShmServer>(controllerConfig.at("shm_server"), controllerCbs));
     }
 
-    LOG_TAGGED(INFO, "IServer::create") << "No server in config file - running serverless." << log::endl;
-    return nullptr;
+    if (servers.empty())
+    {
+        LOG_TAGGED(INFO, "IServer::create") << "No server in config file - running serverless." << log::endl;
+    }
+    return servers;
 }
 
 } // namespace bnet
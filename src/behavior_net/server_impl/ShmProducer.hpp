@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+#include <3rd_party/nlohmann/json.hpp>
+#include <utils/ShmRing.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// Message types of the shared memory ingress; bodies are CBOR encoded json, as in the TCP server protocol
+BETTER_ENUM(ShmMessageType, uint8_t,
+            ADD_TOKEN = 1,            // `/add_token` payload
+            TRIGGER_MANUAL_TRANSITION // transition id
+)
+
+/**
+ * @brief Producer side of the `ShmServer` ingress, for processes on the same host as the controller. Depends on the
+ * header-only ring and json libraries only.
+ *
+ * Requests are fire-and-forget: they are copied into the ring without syscalls, and errors (e.g., an unknown place)
+ * are only logged by the controller. Not thread safe: use one producer per thread. Any number of producers, in any
+ * number of processes, can share a ring.
+ */
+class ShmProducer
+{
+public:
+    /// @param name the "name" of the `shm_server` config
+    /// @throw std::runtime_error if the ring does not exist, i.e., the controller is not running
+    explicit ShmProducer(std::string const& name)
+        : m_ring(ShmRing::open(name))
+    {
+    }
+
+    /// @return false if the ring is full; the request was not sent and may be retried
+    /// @throw std::length_error if the encoded request does not fit in a ring slot
+    bool addToken(nlohmann::json const& contentBlocks, std::string_view placeId,
+                  std::optional<std::chrono::milliseconds> ttl = std::nullopt)
+    {
+        nlohmann::json payload{{"place_id", placeId}, {"content_blocks", contentBlocks}};
+        if (ttl.has_value())
+        {
+            payload["ttl_ms"] = static_cast<uint32_t>(ttl->count());
+        }
+        return push(ShmMessageType::ADD_TOKEN, payload);
+    }
+
+    /// @return false if the ring is full; the request was not sent and may be retried
+    bool triggerManualTransition(std::string_view transitionId)
+    {
+        return push(ShmMessageType::TRIGGER_MANUAL_TRANSITION, nlohmann::json(transitionId));
+    }
+
+private:
+    bool push(ShmMessageType type, nlohmann::json const& body)
+    {
+        m_buffer.clear();
+        nlohmann::json::to_cbor(body, m_buffer);
+        return m_ring->tryPush(type._to_integral(), m_buffer);
+    }
+
+    std::unique_ptr<ShmRing> m_ring;
+    std::string m_buffer;
+};
+
+} // namespace bnet
+} // namespace capybot
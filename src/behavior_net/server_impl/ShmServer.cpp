@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/server_impl/ShmServer.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateShmServerConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("shm_server"))
+    {
+        return true; // shared memory server not in config
+    }
+    auto serverConfig = getValueAtPath<nlohmann::json>(netConfig, {"controller", "shm_server"}, errorMessages).value();
+
+    // check expected info exists in expected format
+    const auto name = getValueAtKey<std::string>(serverConfig, "name", errorMessages);
+    if (name.has_value() && (name->size() < 2U || name->front() != '/' || name->find('/', 1U) != std::string::npos))
+    {
+        errorMessages.push_back("Invalid `name` (expected a single leading slash, e.g. \"/bnet_ingress\") for "
+                                "shm_server.");
+    }
+    for (auto&& key : {"slot_count", "slot_size", "drain_period_us"})
+    {
+        if (serverConfig.contains(key) && (!serverConfig.at(key).is_number_unsigned() ||
+                                           serverConfig.at(key).get<uint64_t>() == 0U ||
+                                           serverConfig.at(key).get<uint64_t>() > UINT32_MAX))
+        {
+            errorMessages.push_back(std::string("Invalid `") + key + "` (expected a positive integer) for shm_server.");
+        }
+    }
+    if (serverConfig.contains("slot_count") && serverConfig.at("slot_count").is_number_unsigned())
+    {
+        const auto slotCount = serverConfig.at("slot_count").get<uint64_t>();
+        if (slotCount < 2U || (slotCount & (slotCount - 1U)) != 0U)
+        {
+            errorMessages.push_back("Invalid `slot_count` (expected a power of 2) for shm_server.");
+        }
+    }
+    if (serverConfig.contains("mode"))
+    {
+        const auto mode = getValueAtKey<std::string>(serverConfig, "mode", errorMessages);
+        if (mode.has_value() &&
+            (mode->empty() || mode->size() > 4U || mode->find_first_not_of("01234567") != std::string::npos))
+        {
+            errorMessages.push_back("Invalid `mode` (expected octal permissions, e.g. \"0660\") for shm_server.");
+        }
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateShmServerConfig, "ShmServerConfigValidator");
+
+namespace
+{
+template <typename T>
+T getParameter(nlohmann::json const& config, std::string const& key, T defaultValue)
+{
+    return config.contains(key) ? config.at(key).get<T>() : defaultValue;
+}
+} // namespace
+
+ShmServer::ShmServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs)
+    : m_controllerCbs(controllerCbs)
+    , m_name(config.at("name").get<std::string>())
+    , m_slotCount(getParameter<uint32_t>(config, "slot_count", DEFAULT_SLOT_COUNT))
+    , m_slotSize(getParameter<uint32_t>(config, "slot_size", DEFAULT_SLOT_SIZE))
+    , m_drainPeriod(getParameter<uint32_t>(config, "drain_period_us", DEFAULT_DRAIN_PERIOD_US))
+{
+    if (config.contains("mode"))
+    {
+        m_mode = static_cast<mode_t>(std::stoul(config.at("mode").get<std::string>(), nullptr, 8));
+    }
+
+    LOG(INFO) << "Running @ shm://" << m_name << log::endl;
+}
+
+void ShmServer::start()
+{
+    try
+    {
+        m_ring = ShmRing::create(m_name, m_slotCount, m_slotSize, m_mode);
+    }
+    catch (std::exception const& e)
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "ShmServer::start: failed to create the ring.")
+            .appendMetadata("name", m_name)
+            .appendMetadata("error", e.what());
+    }
+    m_drainThread = std::thread([this] { drainRing(); });
+}
+
+void ShmServer::stop()
+{
+    m_stopping.store(true);
+    if (m_drainThread.joinable())
+    {
+        m_drainThread.join();
+    }
+    m_ring.reset(); // removes the shared memory object
+}
+
+void ShmServer::drainRing()
+{
+    LOG(DEBUG) << "drainRing: draining requests..." << log::endl;
+    std::vector<Request> requests;
+    std::size_t droppedCount{0U};
+    while (!m_stopping.load())
+    {
+        requests.clear();
+        m_ring->drain(
+            [this, &requests](uint8_t type, std::string_view body) {
+                try
+                {
+                    const auto json = nlohmann::json::from_cbor(body.begin(), body.end());
+                    if (type == +ShmMessageType::ADD_TOKEN)
+                    {
+                        requests.emplace_back(TokenRequest::fromJson(json));
+                    }
+                    else if (type == +ShmMessageType::TRIGGER_MANUAL_TRANSITION)
+                    {
+                        requests.emplace_back(json.get<std::string>());
+                    }
+                    else
+                    {
+                        LOG(WARN) << "drainRing: dropping request of unknown type " << static_cast<int>(type)
+                                  << log::endl;
+                    }
+                }
+                catch (std::exception const& e)
+                {
+                    LOG(WARN) << "drainRing: dropping invalid request: " << e.what() << log::endl;
+                }
+            },
+            m_slotCount);
+
+        if (const auto dropped = m_ring->getDroppedCount(); dropped != droppedCount)
+        {
+            LOG(WARN) << "drainRing: dropped " << dropped - droppedCount << " request(s) with a corrupted size"
+                      << log::endl;
+            droppedCount = dropped;
+        }
+        if (requests.empty())
+        {
+            std::this_thread::sleep_for(m_drainPeriod);
+            continue;
+        }
+        handleRequests(requests);
+    }
+    LOG(DEBUG) << "drainRing: exiting..." << log::endl;
+}
+
+void ShmServer::handleRequests(std::vector<Request>& requests)
+{
+    for (auto it = requests.begin(); it != requests.end();)
+    {
+        const auto batchEnd = std::find_if(it, requests.end(), [&it](Request const& request) {
+            return request.index() != it->index();
+        });
+
+        BulkResults results;
+        try
+        {
+            if (std::holds_alternative<TokenRequest>(*it))
+            {
+                std::vector<TokenRequest> tokens;
+                std::transform(it, batchEnd, std::back_inserter(tokens),
+                               [](Request& request) { return std::move(std::get<TokenRequest>(request)); });
+                results = m_controllerCbs.addTokens(std::move(tokens));
+            }
+            else
+            {
+                std::vector<std::string> ids;
+                std::transform(it, batchEnd, std::back_inserter(ids),
+                               [](Request& request) { return std::move(std::get<std::string>(request)); });
+                results = m_controllerCbs.triggerManualTransitions(ids);
+            }
+        }
+        catch (std::exception const& e)
+        {
+            LOG(ERROR) << "handleRequests: " << std::distance(it, batchEnd) << " requests failed: " << e.what()
+                       << log::endl;
+        }
+        for (auto&& error : results)
+        {
+            if (error.has_value())
+            {
+                LOG(WARN) << "handleRequests: request failed: " << error.value() << log::endl;
+            }
+        }
+        it = batchEnd;
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/server_impl/ShmProducer.hpp>
+#include <utils/ShmRing.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Ingress for the highest rate producers on the same host: a shared memory ring (`ShmRing`) that producers
+ * write requests into with `ShmProducer`, without syscalls. See `ShmMessageType`.
+ *
+ * A single thread drains the ring whenever it has requests, and polls it every "drain_period_us" otherwise. All
+ * requests drained at once are handled together, i.e., consecutive token requests are added in a single controller
+ * step. There are no responses: failing requests are logged.
+ *
+ * Config ("shm_server"):
+ *  "name" [string] name of the shared memory object, e.g. "/bnet_ingress"
+ *  "slot_count" [uint32_t][default: 4096] ring capacity, a power of 2; producers are refused while it is full
+ *  "slot_size" [uint32_t][default: 4096] max size of an encoded request
+ *  "drain_period_us" [uint32_t][default: 100] polling period while the ring is empty
+ *  "mode" [string] octal permissions of the shared memory object, e.g. "0660"; only the umask applies if not set
+ */
+class ShmServer : public IServer
+{
+    static constexpr const char* MODULE_TAG{"ShmServer"};
+
+public:
+    ShmServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs);
+
+    ~ShmServer() { stop(); }
+
+    void start() override;
+
+    void stop() override;
+
+private:
+    /// @brief a token to add, or the id of a manual transition to trigger
+    using Request = std::variant<TokenRequest, std::string>;
+
+    void drainRing();
+
+    /// @brief handle requests in order, batching consecutive requests of the same type
+    void handleRequests(std::vector<Request>& requests);
+
+    static constexpr uint32_t DEFAULT_SLOT_COUNT{4096U};
+    static constexpr uint32_t DEFAULT_SLOT_SIZE{4096U};
+    static constexpr uint32_t DEFAULT_DRAIN_PERIOD_US{100U};
+
+    ControllerCallbacks m_controllerCbs;
+    std::string m_name;
+    uint32_t m_slotCount;
+    uint32_t m_slotSize;
+    std::chrono::microseconds m_drainPeriod;
+    std::optional<mode_t> m_mode;
+
+    std::unique_ptr<ShmRing> m_ring;
+    std::thread m_drainThread;
+    std::atomic_bool m_stopping{false};
+};
+
+} // namespace bnet
+} // namespace capybot
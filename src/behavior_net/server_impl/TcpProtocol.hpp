@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <3rd_party/better_enums/enums.h>
+#include <behavior_net/Common.hpp>
+#include <behavior_net/Types.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/// Message types of the TCP server protocol - using BETTER_ENUM for helper str member functions
+BETTER_ENUM(TcpMessageType, uint8_t,
+            // requests; bodies are CBOR encoded json
+            ADD_TOKEN = 1,              // `/add_token` payload
+            ADD_TOKENS,                 // array of `/add_token` payloads
+            TRIGGER_MANUAL_TRANSITION,  // transition id
+            TRIGGER_MANUAL_TRANSITIONS, // array of transition ids
+            GET_MARKING,                // {"since": [optional] version}, or empty body
+            // responses, with the id of the request
+            RESPONSE_OK = 128, // empty body, or the result: per item results for bulk requests, marking, ...
+            RESPONSE_ERROR     // {"error": "...", "type": ExceptionType}
+)
+
+/**
+ * @brief Framing of the TCP server protocol.
+ *
+ * Frame = [body size: uint32 big endian][type: uint8][request id: uint32 big endian][body]. Clients may pipeline
+ * requests, i.e., send many before reading responses; responses are sent in request order and carry the request id.
+ */
+struct TcpFrame
+{
+    static constexpr std::size_t HEADER_SIZE{9U};
+
+    uint8_t type;
+    uint32_t requestId;
+    std::string body;
+
+    static void append(std::string& buffer, uint8_t type, uint32_t requestId, std::string_view body)
+    {
+        appendUint32(buffer, static_cast<uint32_t>(body.size()));
+        buffer.push_back(static_cast<char>(type));
+        appendUint32(buffer, requestId);
+        buffer.append(body);
+    }
+
+    /// @return the frame at the front of `buffer`, if complete; sets the number of bytes it takes in `frameSize`
+    /// @throw INVALID_VALUE if the body is larger than `maxBodySize`
+    static std::optional<TcpFrame> parse(std::string_view buffer, std::size_t& frameSize, std::size_t maxBodySize)
+    {
+        if (buffer.size() < HEADER_SIZE)
+        {
+            return std::nullopt;
+        }
+        const auto bodySize = readUint32(buffer.data());
+        if (bodySize > maxBodySize)
+        {
+            throw Exception(ExceptionType::INVALID_VALUE, "TcpFrame::parse: frame body too large.")
+                .appendMetadata("body_size", bodySize)
+                .appendMetadata("max_body_size", maxBodySize);
+        }
+        if (buffer.size() < HEADER_SIZE + bodySize)
+        {
+            return std::nullopt;
+        }
+
+        frameSize = HEADER_SIZE + bodySize;
+        return TcpFrame{.type = static_cast<uint8_t>(buffer[4]),
+                        .requestId = readUint32(buffer.data() + 5),
+                        .body = std::string(buffer.substr(HEADER_SIZE, bodySize))};
+    }
+
+private:
+    static void appendUint32(std::string& buffer, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            buffer.push_back(static_cast<char>((value >> shift) & 0xFFU));
+        }
+    }
+
+    static uint32_t readUint32(const char* data)
+    {
+        uint32_t value{0U};
+        for (int i = 0; i < 4; ++i)
+        {
+            value = (value << 8) | static_cast<uint8_t>(data[i]);
+        }
+        return value;
+    }
+};
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/server_impl/TcpServer.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+
+namespace capybot
+{
+namespace bnet
+{
+
+bool validateTcpServerConfig(nlohmann::json const& netConfig, std::vector<std::string>& errorMessages)
+{
+    errorMessages.clear();
+
+    if (!netConfig.contains("controller") || !netConfig.at("controller").contains("tcp_server"))
+    {
+        return true; // tcp server not in config
+    }
+    auto serverConfig = getValueAtPath<nlohmann::json>(netConfig, {"controller", "tcp_server"}, errorMessages).value();
+
+    // check expected info exists in expected format
+    std::ignore = getValueAtKey<std::string>(serverConfig, "address", errorMessages);
+    std::ignore = getValueAtKey<int>(serverConfig, "port", errorMessages);
+    if (serverConfig.contains("max_frame_size") && (!serverConfig.at("max_frame_size").is_number_unsigned() ||
+                                                    serverConfig.at("max_frame_size").get<uint64_t>() == 0U))
+    {
+        errorMessages.push_back("Invalid `max_frame_size` (expected a positive integer) for tcp_server.");
+    }
+    if (serverConfig.contains("max_connections") && (!serverConfig.at("max_connections").is_number_unsigned() ||
+                                                     serverConfig.at("max_connections").get<uint64_t>() == 0U))
+    {
+        errorMessages.push_back("Invalid `max_connections` (expected a positive integer) for tcp_server.");
+    }
+
+    return errorMessages.empty();
+}
+
+REGISTER_NET_CONFIG_VALIDATOR(&validateTcpServerConfig, "TcpServerConfigValidator");
+
+namespace
+{
+bool sendAll(int fd, std::string const& data)
+{
+    std::size_t sent{0U};
+    while (sent < data.size())
+    {
+        const auto n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+std::string toCbor(nlohmann::json const& json)
+{
+    const auto bytes = nlohmann::json::to_cbor(json);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+nlohmann::json fromCbor(std::string const& body)
+{
+    return body.empty() ? nlohmann::json() : nlohmann::json::from_cbor(body);
+}
+
+void appendError(std::string& out, uint32_t requestId, std::exception const& e)
+{
+    const auto* bnetException = dynamic_cast<Exception const*>(&e);
+    const nlohmann::json error{{"error", e.what()},
+                               {"type", bnetException ? bnetException->type()._to_string() : "RUNTIME_ERROR"}};
+    TcpFrame::append(out, TcpMessageType::RESPONSE_ERROR, requestId, toCbor(error));
+}
+} // namespace
+
+TcpServer::TcpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs)
+    : m_controllerCbs(controllerCbs)
+    , m_addr(config.at("address").get<std::string>())
+    , m_port(config.at("port").get<int>())
+    , m_maxFrameSize(config.contains("max_frame_size") ? config.at("max_frame_size").get<uint32_t>()
+                                                       : DEFAULT_MAX_FRAME_SIZE)
+    , m_maxConnections(config.contains("max_connections") ? config.at("max_connections").get<uint32_t>()
+                                                          : DEFAULT_MAX_CONNECTIONS)
+{
+    LOG(INFO) << "Running @ tcp://" << m_addr << ":" << m_port << log::endl;
+}
+
+void TcpServer::start()
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result{nullptr};
+    if (getaddrinfo(m_addr.c_str(), std::to_string(m_port).c_str(), &hints, &result) != 0 || result == nullptr)
+    {
+        throw Exception(ExceptionType::RUNTIME_ERROR, "TcpServer::start: failed to resolve address.")
+            .appendMetadata("address", m_addr);
+    }
+
+    m_listenFd = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    bool isListening{false};
+    if (m_listenFd >= 0)
+    {
+        const int yes{1};
+        ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        // non blocking, so accept never blocks when a connection is aborted between poll and accept
+        isListening = ::bind(m_listenFd, result->ai_addr, result->ai_addrlen) == 0 &&
+                      ::listen(m_listenFd, SOMAXCONN) == 0 &&
+                      ::fcntl(m_listenFd, F_SETFL, ::fcntl(m_listenFd, F_GETFL) | O_NONBLOCK) == 0;
+    }
+    freeaddrinfo(result);
+    if (!isListening)
+    {
+        const std::string error = std::strerror(errno);
+        if (m_listenFd >= 0)
+        {
+            ::close(m_listenFd);
+            m_listenFd = -1;
+        }
+        throw Exception(ExceptionType::RUNTIME_ERROR, "TcpServer::start: failed to listen.")
+            .appendMetadata("address", m_addr)
+            .appendMetadata("port", m_port)
+            .appendMetadata("error", error);
+    }
+
+    m_wakeFd = ::eventfd(0U, EFD_NONBLOCK);
+    if (m_wakeFd < 0)
+    {
+        const std::string error = std::strerror(errno);
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        throw Exception(ExceptionType::RUNTIME_ERROR, "TcpServer::start: failed to create eventfd.")
+            .appendMetadata("error", error);
+    }
+
+    m_acceptThread = std::thread([this] { acceptConnections(); });
+}
+
+void TcpServer::stop()
+{
+    m_stopping.store(true);
+    if (m_wakeFd >= 0)
+    {
+        const uint64_t one{1U};
+        std::ignore = ::write(m_wakeFd, &one, sizeof(one)); // unblocks poll
+    }
+    if (m_acceptThread.joinable())
+    {
+        m_acceptThread.join();
+    }
+    if (m_listenFd >= 0)
+    {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+
+    // connections are only closed here or when reaped, so every fd in the list is still ours
+    std::lock_guard<std::mutex> lk(m_connectionsMtx);
+    for (auto&& connection : m_connections)
+    {
+        ::shutdown(connection.fd, SHUT_RDWR); // unblocks recv
+    }
+    for (auto&& connection : m_connections)
+    {
+        connection.thread.join();
+        ::close(connection.fd);
+    }
+    m_connections.clear();
+    if (m_wakeFd >= 0)
+    {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+void TcpServer::acceptConnections()
+{
+    LOG(DEBUG) << "acceptConnections: accepting connections..." << log::endl;
+    std::array<pollfd, 2> fds{pollfd{.fd = m_listenFd, .events = POLLIN, .revents = 0},
+                              pollfd{.fd = m_wakeFd, .events = POLLIN, .revents = 0}};
+    while (!m_stopping.load())
+    {
+        if (::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0)
+        {
+            uint64_t count{0U};
+            std::ignore = ::read(m_wakeFd, &count, sizeof(count));
+            reapConnections();
+        }
+        if (fds[0].revents == 0)
+        {
+            continue;
+        }
+
+        const int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                continue;
+            }
+            break;
+        }
+        const int yes{1};
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        reapConnections();
+        std::lock_guard<std::mutex> lk(m_connectionsMtx);
+        if (m_stopping.load())
+        {
+            ::close(fd);
+            break;
+        }
+        if (m_connections.size() >= m_maxConnections)
+        {
+            LOG(WARN) << "acceptConnections: closing new connection, max_connections reached: " << m_maxConnections
+                      << log::endl;
+            ::close(fd);
+            continue;
+        }
+        auto& connection = m_connections.emplace_back();
+        connection.fd = fd;
+        connection.thread = std::thread([this, &connection] { serveConnection(connection); });
+    }
+    LOG(DEBUG) << "acceptConnections: exiting..." << log::endl;
+}
+
+void TcpServer::reapConnections()
+{
+    std::lock_guard<std::mutex> lk(m_connectionsMtx);
+    for (auto it = m_connections.begin(); it != m_connections.end();)
+    {
+        if (it->isDone.load())
+        {
+            it->thread.join();
+            ::close(it->fd);
+            it = m_connections.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void TcpServer::serveConnection(Connection& connection)
+{
+    std::string in;
+    std::string out;
+    std::vector<char> readBuffer(64U * 1024U);
+    while (!m_stopping.load())
+    {
+        const auto n = ::recv(connection.fd, readBuffer.data(), readBuffer.size(), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        in.append(readBuffer.data(), static_cast<std::size_t>(n));
+
+        std::vector<TcpFrame> frames;
+        std::size_t offset{0U};
+        try
+        {
+            std::size_t frameSize{0U};
+            while (auto frame = TcpFrame::parse(std::string_view(in).substr(offset), frameSize, m_maxFrameSize))
+            {
+                frames.push_back(std::move(frame.value()));
+                offset += frameSize;
+            }
+        }
+        catch (Exception const& e)
+        {
+            LOG(WARN) << "serveConnection: closing connection, " << e.what() << log::endl;
+            break;
+        }
+        in.erase(0, offset);
+
+        handleFrames(frames, out);
+        if (!sendAll(connection.fd, out))
+        {
+            break;
+        }
+        out.clear();
+    }
+
+    ::shutdown(connection.fd, SHUT_RDWR); // the peer sees the connection closed; the fd is closed once reaped
+    connection.isDone.store(true);
+    const uint64_t one{1U};
+    std::ignore = ::write(m_wakeFd, &one, sizeof(one));
+}
+
+void TcpServer::handleFrames(std::vector<TcpFrame>& frames, std::string& out)
+{
+    for (std::size_t i = 0; i < frames.size();)
+    {
+        if (frames.at(i).type != +TcpMessageType::ADD_TOKEN)
+        {
+            try
+            {
+                const auto result = handleRequest(frames.at(i));
+                TcpFrame::append(out, TcpMessageType::RESPONSE_OK, frames.at(i).requestId,
+                                 result.is_null() ? std::string() : toCbor(result));
+            }
+            catch (std::exception const& e)
+            {
+                appendError(out, frames.at(i).requestId, e);
+            }
+            ++i;
+            continue;
+        }
+
+        // consecutive ADD_TOKEN requests are added in a single controller step
+        std::vector<TokenRequest> requests;
+        std::vector<std::optional<std::string>> parseErrors;
+        const auto first = i;
+        for (; i < frames.size() && frames.at(i).type == +TcpMessageType::ADD_TOKEN; ++i)
+        {
+            try
+            {
+                requests.push_back(TokenRequest::fromJson(fromCbor(frames.at(i).body)));
+                parseErrors.push_back(std::nullopt);
+            }
+            catch (std::exception const& e)
+            {
+                parseErrors.push_back(std::string("invalid token: ") + e.what());
+            }
+        }
+        const auto results = m_controllerCbs.addTokens(std::move(requests));
+        auto resultIt = results.begin();
+        for (std::size_t j = first; j < i; ++j)
+        {
+            const auto& error = parseErrors.at(j - first).has_value() ? parseErrors.at(j - first) : *resultIt++;
+            if (error.has_value())
+            {
+                TcpFrame::append(out, TcpMessageType::RESPONSE_ERROR, frames.at(j).requestId,
+                                 toCbor({{"error", error.value()}}));
+            }
+            else
+            {
+                TcpFrame::append(out, TcpMessageType::RESPONSE_OK, frames.at(j).requestId, {});
+            }
+        }
+    }
+}
+
+nlohmann::json TcpServer::handleRequest(TcpFrame const& frame)
+{
+    const auto typeOpt = TcpMessageType::_from_integral_nothrow(frame.type);
+    if (!typeOpt)
+    {
+        throw Exception(ExceptionType::INVALID_VALUE, "TcpServer::handleRequest: unknown message type.")
+            .appendMetadata("type", frame.type);
+    }
+
+    auto body = fromCbor(frame.body);
+    switch (*typeOpt)
+    {
+    case TcpMessageType::ADD_TOKENS: {
+        std::vector<TokenRequest> requests;
+        for (auto&& payload : body)
+        {
+            requests.push_back(TokenRequest::fromJson(std::move(payload)));
+        }
+        return toJson(m_controllerCbs.addTokens(std::move(requests)));
+    }
+    case TcpMessageType::TRIGGER_MANUAL_TRANSITION:
+        m_controllerCbs.triggerManualTransition(body.get<std::string>());
+        return nullptr;
+    case TcpMessageType::TRIGGER_MANUAL_TRANSITIONS:
+        return toJson(m_controllerCbs.triggerManualTransitions(body.get<std::vector<std::string>>()));
+    case TcpMessageType::GET_MARKING:
+        return m_controllerCbs.getNetMarking(body.is_object() && body.contains("since")
+                                                 ? std::optional(body.at("since").get<uint64_t>())
+                                                 : std::nullopt);
+    default:
+        throw Exception(ExceptionType::INVALID_VALUE, "TcpServer::handleRequest: not a request message type.")
+            .appendMetadata("type", frame.type);
+    }
+}
+
+} // namespace bnet
+} // namespace capybot
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <behavior_net/Controller.hpp>
+#include <behavior_net/server_impl/TcpProtocol.hpp>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace capybot
+{
+namespace bnet
+{
+
+/**
+ * @brief Server for high rate clients: persistent TCP connections carrying length prefixed binary frames with CBOR
+ * bodies, see `TcpFrame` and `TcpMessageType`.
+ *
+ * One thread per connection; threads of closed connections are joined as soon as they finish. All frames read at once
+ * are handled together, so consecutive pipelined ADD_TOKEN requests are added in a single controller step, and their
+ * responses are written with a single send.
+ *
+ * Config ("tcp_server"):
+ *  "address" [string] listening address
+ *  "port" [int] listening port
+ *  "max_frame_size" [uint32_t][default: 16 MiB] max body size; connections sending larger frames are closed
+ *  "max_connections" [uint32_t][default: 256] open connections; new ones past the limit are closed right away
+ */
+class TcpServer : public IServer
+{
+    static constexpr const char* MODULE_TAG{"TcpServer"};
+
+public:
+    TcpServer(nlohmann::json const& config, ControllerCallbacks const& controllerCbs);
+
+    ~TcpServer() { stop(); }
+
+    void start() override;
+
+    void stop() override;
+
+private:
+    struct Connection
+    {
+        int fd; // closed by whoever joins `thread`, so that its number is never reused while still referenced
+        std::thread thread;
+        std::atomic_bool isDone{false};
+    };
+
+    /// @brief accept connections, and reap finished ones when woken up through `m_wakeFd`
+    void acceptConnections();
+
+    void serveConnection(Connection& connection);
+
+    /// @brief handle requests in order, appending their responses to `out`
+    void handleFrames(std::vector<TcpFrame>& frames, std::string& out);
+
+    /// @return result to be sent in the RESPONSE_OK body; nullptr for an empty body
+    nlohmann::json handleRequest(TcpFrame const& frame);
+
+    /// @brief join, close, and forget connections that were shut down
+    void reapConnections();
+
+    static constexpr uint32_t DEFAULT_MAX_FRAME_SIZE{16U * 1024U * 1024U};
+    static constexpr uint32_t DEFAULT_MAX_CONNECTIONS{256U};
+
+    ControllerCallbacks m_controllerCbs;
+    std::string m_addr;
+    int m_port;
+    uint32_t m_maxFrameSize;
+    uint32_t m_maxConnections;
+
+    int m_listenFd{-1};
+    int m_wakeFd{-1}; // eventfd, signaled when a connection finishes or the server stops
+    std::thread m_acceptThread;
+    std::atomic_bool m_stopping{false};
+
+    std::list<Connection> m_connections;
+    std::mutex m_connectionsMtx;
+};
+
+} // namespace bnet
+} // namespace capybot
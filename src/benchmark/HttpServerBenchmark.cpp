@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <3rd_party/cpp-httplib/httplib.h>
+#include <3rd_party/taywee/args.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <behavior_net/Controller.hpp>
+#include <utils/Logger.hpp>
+
+/**
+ * Drives the controller HttpServer with concurrent keep-alive clients, one endpoint at a time, and reports throughput
+ * and latency percentiles per endpoint. Server tuning comes from the `controller.http_server` section of the config.
+ */
+
+using namespace capybot;
+
+struct CmdLineArgs
+{
+    std::string configPath{"config_samples/config.json"};
+    uint32_t clients{8U};
+    uint32_t durationMs{2000U};
+    std::string placeId{"A"};
+    bool unixSocket{false};
+};
+
+/// @brief where the server listens: TCP address and port, or Unix domain socket path
+struct Target
+{
+    std::string host;
+    int port;
+    bool isUnixSocket;
+
+    std::unique_ptr<httplib::Client> makeClient() const
+    {
+        auto cli = std::make_unique<httplib::Client>(host, port);
+        if (isUnixSocket)
+        {
+            cli->set_address_family(AF_UNIX);
+        }
+        return cli;
+    }
+};
+
+struct Endpoint
+{
+    std::string method;
+    std::string path;
+    std::string body;
+};
+
+struct EndpointResult
+{
+    uint64_t requests{0U};
+    uint64_t errors{0U};
+    std::vector<std::chrono::nanoseconds> latencies;
+    std::chrono::nanoseconds wallTime{0}; // from starting the clients until all of them finished
+};
+
+std::optional<CmdLineArgs> parseArgs(int argc, char** argv)
+{
+    args::ArgumentParser parser("Behavior Net - HttpServer throughput benchmark.");
+    args::HelpFlag help(parser, "help", "<help menu>", {'h', "help"});
+
+    args::Positional<std::string> configPath(parser, "config_path", "Configuration file path.");
+    args::ValueFlag<uint32_t> clients(parser, "clients", "Number of concurrent clients.", {"clients"});
+    args::ValueFlag<uint32_t> durationMs(parser, "duration_ms", "Duration per endpoint.", {"duration_ms"});
+    args::ValueFlag<std::string> placeId(parser, "place_id", "Place `/add_token` adds tokens to.", {"place_id"});
+    args::Flag unixSocket(parser, "unix_socket", "Connect through `unix_socket_path`.", {"unix_socket"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return std::nullopt;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << "\n==>> Failed to parse command line arguments.\n"
+                  << "==>> error info: " << e.what() << "\n\n"
+                  << "==>> help:\n"
+                  << parser;
+        return std::nullopt;
+    }
+
+    CmdLineArgs cliArgs;
+    if (configPath)
+    {
+        cliArgs.configPath = args::get(configPath);
+    }
+    if (clients)
+    {
+        cliArgs.clients = std::max(1U, args::get(clients));
+    }
+    if (durationMs)
+    {
+        cliArgs.durationMs = args::get(durationMs);
+    }
+    if (placeId)
+    {
+        cliArgs.placeId = args::get(placeId);
+    }
+    cliArgs.unixSocket = unixSocket;
+    return cliArgs;
+}
+
+EndpointResult runEndpoint(Target const& target, Endpoint const& endpoint, CmdLineArgs const& cliArgs)
+{
+    const auto begin = std::chrono::steady_clock::now();
+    const auto deadline = begin + std::chrono::milliseconds(cliArgs.durationMs);
+
+    std::vector<EndpointResult> clientResults(cliArgs.clients);
+    std::vector<std::thread> clients;
+    for (auto&& result : clientResults)
+    {
+        clients.emplace_back([&] {
+            auto cli = target.makeClient();
+            cli->set_keep_alive(true);
+            cli->set_tcp_nodelay(!target.isUnixSocket);
+            while (std::chrono::steady_clock::now() < deadline)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const auto res = endpoint.method == "GET"
+                                     ? cli->Get(endpoint.path)
+                                     : cli->Post(endpoint.path, endpoint.body, "application/json");
+                result.latencies.push_back(std::chrono::steady_clock::now() - start);
+                ++result.requests;
+                if (!res || res->status >= 400)
+                {
+                    ++result.errors;
+                }
+            }
+        });
+    }
+    for (auto&& client : clients)
+    {
+        client.join();
+    }
+
+    // the last requests end after the deadline, and slow ones by a lot: rates are over the measured time
+    EndpointResult total;
+    total.wallTime = std::chrono::steady_clock::now() - begin;
+    for (auto&& result : clientResults)
+    {
+        total.requests += result.requests;
+        total.errors += result.errors;
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+    return total;
+}
+
+void printResult(Endpoint const& endpoint, EndpointResult const& result)
+{
+    const auto percentileUs = [&result](double pct) {
+        if (result.latencies.empty())
+        {
+            return 0.0;
+        }
+        const auto idx = static_cast<std::size_t>(pct / 100.0 * static_cast<double>(result.latencies.size() - 1U));
+        return std::chrono::duration<double, std::micro>(result.latencies.at(idx)).count();
+    };
+
+    std::cout << std::left << std::setw(6) << endpoint.method << std::setw(28) << endpoint.path << std::right
+              << std::fixed << std::setprecision(0) << std::setw(12)
+              << static_cast<double>(result.requests) / std::chrono::duration<double>(result.wallTime).count()
+              << std::setw(10) << result.errors
+              << std::setprecision(1) << std::setw(12) << percentileUs(50.0) << std::setw(12) << percentileUs(90.0)
+              << std::setw(12) << percentileUs(99.0) << std::setw(12) << percentileUs(100.0) << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    auto cliArgs = parseArgs(argc, argv);
+    if (!cliArgs.has_value())
+    {
+        return EXIT_SUCCESS;
+    }
+
+    auto logger = std::make_unique<log::DefaultLogger>();
+    log::Logger::set(std::move(logger));
+    log::Logger::get()->setLogLevel(log::LogLevel::WARN);
+
+    auto config = bnet::NetConfig(cliArgs->configPath);
+    const auto& serverConfig = config.get().at("controller").at("http_server");
+    const auto target = cliArgs->unixSocket
+                            ? Target{serverConfig.at("unix_socket_path").get<std::string>(), 0, true}
+                            : Target{serverConfig.at("address").get<std::string>(), serverConfig.at("port").get<int>(),
+                                     false};
+
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    controller.runDetached();
+
+    // wait for the server to be up
+    auto probe = target.makeClient();
+    const auto probeDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!probe->Get("/"))
+    {
+        if (std::chrono::steady_clock::now() > probeDeadline)
+        {
+            std::cerr << "Server not reachable @ " << target.host << ":" << target.port << "\n";
+            return EXIT_FAILURE;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    const std::vector<Endpoint> endpoints{
+        {"GET", "/", ""},
+        {"GET", "/get_marking", ""},
+        {"GET", "/get_marking?since=0", ""},
+        {"GET", "/get_config", ""},
+        {"POST", "/add_token", R"({"place_id": ")" + cliArgs->placeId + R"(", "content_blocks": {"benchmark": {}}})"},
+    };
+
+    std::cout << cliArgs->clients << " clients, " << cliArgs->durationMs << " ms per endpoint; latencies in us\n\n"
+              << std::left << std::setw(6) << "" << std::setw(28) << "Endpoint" << std::right << std::setw(12)
+              << "req/s" << std::setw(10) << "errors" << std::setw(12) << "p50" << std::setw(12) << "p90"
+              << std::setw(12) << "p99" << std::setw(12) << "max"
+              << "\n";
+    for (auto&& endpoint : endpoints)
+    {
+        printResult(endpoint, runEndpoint(target, endpoint, cliArgs.value()));
+    }
+
+    controller.stop();
+    return EXIT_SUCCESS;
+}
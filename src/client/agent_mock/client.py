@@ -115,6 +115,12 @@ class Agent:
         else:
             return "IN_PROGRESS"
 
+    def get_task_remaining_time(self) -> float:
+        """ remaining execution time of the current task, in seconds; used as polling hint (Retry-After) """
+        if self.__task_is_done():
+            return 0.0
+        return EXEC_TIME_TABLE_SEC[self.task_in_exec] - (time.time() - self.task_start_time)
+
     def __task_is_done(self):
         delta = time.time() - self.task_start_time
         return self.task_in_exec == "" or delta > EXEC_TIME_TABLE_SEC[self.task_in_exec]
@@ -136,14 +142,20 @@ agent = Agent()
 app = Flask(__name__)
 
 
+def with_retry_after(status):
+    if status == "IN_PROGRESS":
+        return status, 200, {"Retry-After": f"{agent.get_task_remaining_time():.3f}"}
+    return status
+
+
 @app.route('/execute/<task_id>', methods=['GET', 'POST'])
 def task_request(task_id):
-    return agent.execute(task_id)
+    return with_retry_after(agent.execute(task_id))
 
 
 @app.route('/get_status/<task_id>', methods=['GET', 'POST'])
 def status_request(task_id):
-    return agent.get_task_status(task_id)
+    return with_retry_after(agent.get_task_status(task_id))
 
 
 @app.route('/print_state',  methods=['GET', 'POST'])
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace capybot
+{
+
+/**
+ * @brief Sequence of events that readers consume at their own pace, e.g., state deltas pushed to stream subscribers.
+ *
+ * Each published event gets the next sequence number (starting at 1). Readers only keep the last sequence number they
+ * have seen and block until newer events are published, so an update costs O(events) rather than O(readers × state).
+ * Only the latest `historySize` events are kept; readers that fall further behind are told so and should resync.
+ */
+template <typename EventT>
+class ChangeFeed
+{
+public:
+    struct Changes
+    {
+        uint64_t lastSequence{0U}; // sequence number of the last event in `events`, or the input one if none
+        std::vector<EventT> events;
+        // false if events after the input sequence number were dropped from the history, or if the input sequence
+        // number was never published by this feed, e.g., it comes from a reader of a previous instance
+        bool isComplete{true};
+    };
+
+    explicit ChangeFeed(std::size_t historySize)
+        : m_historySize(historySize)
+    {
+    }
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    /// @return the sequence number of the event
+    uint64_t publish(EventT event)
+    {
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_history.push_back(std::move(event));
+            if (m_history.size() > m_historySize)
+            {
+                m_history.pop_front();
+            }
+            sequence = ++m_lastSequence;
+        }
+        m_cv.notify_all();
+        return sequence;
+    }
+
+    uint64_t getLastSequence() const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return m_lastSequence;
+    }
+
+    /// @brief wait up to `timeout` for events published after `sinceSequence`
+    /// @return empty `events` on timeout; incomplete changes right away if `sinceSequence` is ahead of the feed
+    template <typename Rep, typename Period>
+    Changes waitForChanges(uint64_t sinceSequence, std::chrono::duration<Rep, Period> timeout) const
+    {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_cv.wait_for(lk, timeout, [&] { return m_lastSequence != sinceSequence; });
+
+        Changes changes;
+        if (sinceSequence > m_lastSequence)
+        {
+            changes.lastSequence = m_lastSequence;
+            changes.isComplete = false;
+            return changes;
+        }
+        changes.lastSequence = m_lastSequence;
+        const uint64_t firstAvailable = m_lastSequence - m_history.size() + 1U;
+        changes.isComplete = sinceSequence + 1U >= firstAvailable;
+        for (uint64_t seq = std::max(sinceSequence + 1U, firstAvailable); seq <= m_lastSequence; ++seq)
+        {
+            changes.events.push_back(m_history.at(seq - firstAvailable));
+        }
+        return changes;
+    }
+
+private:
+    const std::size_t m_historySize;
+    std::deque<EventT> m_history; // events (m_lastSequence - size, m_lastSequence]
+    uint64_t m_lastSequence{0U};
+
+    mutable std::mutex m_mtx;
+    mutable std::condition_variable m_cv;
+};
+
+} // namespace capybot
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace capybot
+{
+
+/**
+ * @brief Circuit breaker for calls to a remote endpoint that may become unreachable.
+ *
+ * CLOSED: calls go through. After `failureThreshold` consecutive failures the circuit OPENs and calls are rejected
+ * without reaching the endpoint. After `openDuration`, the circuit is HALF_OPEN: a single probe call goes through;
+ * its success closes the circuit and its failure opens it again for another `openDuration`.
+ */
+class CircuitBreaker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State
+    {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    CircuitBreaker(uint32_t failureThreshold, Clock::duration openDuration)
+        : m_failureThreshold(failureThreshold > 0U ? failureThreshold : 1U)
+        , m_openDuration(openDuration)
+    {
+    }
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    /// @return whether a call may go through now; if so, its outcome must be reported with recordSuccess/Failure
+    bool tryAcquire(Clock::time_point now = Clock::now())
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        switch (m_state)
+        {
+        case State::CLOSED:
+            return true;
+        case State::OPEN:
+            if (now < m_openUntil)
+            {
+                return false;
+            }
+            m_state = State::HALF_OPEN;
+            m_probeInFlight = true;
+            return true;
+        case State::HALF_OPEN:
+            if (m_probeInFlight)
+            {
+                return false;
+            }
+            m_probeInFlight = true;
+            return true;
+        }
+        return false;
+    }
+
+    void recordSuccess()
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_state = State::CLOSED;
+        m_consecutiveFailures = 0U;
+        m_probeInFlight = false;
+    }
+
+    void recordFailure(Clock::time_point now = Clock::now())
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        ++m_consecutiveFailures;
+        if (m_state == State::HALF_OPEN || m_consecutiveFailures >= m_failureThreshold)
+        {
+            m_state = State::OPEN;
+            m_openUntil = now + m_openDuration;
+        }
+        m_probeInFlight = false;
+    }
+
+    State getState() const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return m_state;
+    }
+
+    /// @return time until a probe call is allowed; zero if not OPEN
+    Clock::duration getRemainingOpenTime(Clock::time_point now = Clock::now()) const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return (m_state == State::OPEN && now < m_openUntil) ? m_openUntil - now : Clock::duration::zero();
+    }
+
+private:
+    const uint32_t m_failureThreshold;
+    const Clock::duration m_openDuration;
+
+    State m_state{State::CLOSED};
+    uint32_t m_consecutiveFailures{0U};
+    Clock::time_point m_openUntil{};
+    bool m_probeInFlight{false}; // only one call goes through while HALF_OPEN
+    mutable std::mutex m_mtx;
+};
+
+} // namespace capybot
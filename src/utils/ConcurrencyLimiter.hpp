@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace capybot
+{
+
+/**
+ * @brief Non-blocking counting semaphores, one per key (e.g., per remote host).
+ *
+ * Callers that fail to acquire are expected to retry later rather than wait, so no thread is ever parked on a limit.
+ */
+class ConcurrencyLimiter
+{
+public:
+    ConcurrencyLimiter() = default;
+    ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+    ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+    /// @return whether a slot was acquired for `key`, i.e., fewer than `limit` slots were in use; must be released
+    bool tryAcquire(std::string const& key, uint32_t limit)
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        auto& inUse = m_inUse[key];
+        if (inUse >= limit)
+        {
+            return false;
+        }
+        ++inUse;
+        return true;
+    }
+
+    void release(std::string const& key)
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        const auto it = m_inUse.find(key);
+        if (it != m_inUse.end() && --it->second == 0U)
+        {
+            m_inUse.erase(it);
+        }
+    }
+
+    uint32_t getInUse(std::string const& key) const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        const auto it = m_inUse.find(key);
+        return it != m_inUse.end() ? it->second : 0U;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> m_inUse;
+    mutable std::mutex m_mtx;
+};
+
+} // namespace capybot
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <zlib.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace capybot
+{
+namespace gzip
+{
+
+/// @return `data` in gzip format, e.g., for `Content-Encoding: gzip`
+inline std::string compress(std::string_view data, int level = Z_DEFAULT_COMPRESSION)
+{
+    z_stream stream{};
+    constexpr int GZIP_WINDOW_BITS{15 + 16}; // max window, gzip header
+    if (deflateInit2(&stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("gzip::compress: deflateInit2 failed.");
+    }
+
+    std::string compressed(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    const auto ret = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END)
+    {
+        throw std::runtime_error("gzip::compress: deflate failed.");
+    }
+    return compressed;
+}
+
+inline std::string decompress(std::string_view data)
+{
+    z_stream stream{};
+    constexpr int GZIP_WINDOW_BITS{15 + 16};
+    if (inflateInit2(&stream, GZIP_WINDOW_BITS) != Z_OK)
+    {
+        throw std::runtime_error("gzip::decompress: inflateInit2 failed.");
+    }
+
+    std::string decompressed;
+    char buffer[16384];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    int ret;
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END)
+        {
+            inflateEnd(&stream);
+            throw std::runtime_error("gzip::decompress: invalid gzip data.");
+        }
+        decompressed.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (ret != Z_STREAM_END && stream.avail_in > 0U);
+    inflateEnd(&stream);
+
+    if (ret != Z_STREAM_END)
+    {
+        throw std::runtime_error("gzip::decompress: truncated gzip data.");
+    }
+    return decompressed;
+}
+
+} // namespace gzip
+} // namespace capybot
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace capybot
+{
+
+/**
+ * @brief Tracks recent latency samples per key (e.g., per host) and estimates their percentiles.
+ *
+ * Only the last `windowSize` samples of each key are kept, so estimates follow changes in network conditions.
+ */
+class LatencyTracker
+{
+public:
+    using Duration = std::chrono::microseconds;
+
+    explicit LatencyTracker(std::size_t windowSize = 128U)
+        : m_windowSize(std::max<std::size_t>(windowSize, 1U))
+    {
+    }
+
+    void record(std::string const& key, Duration latency)
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+
+        auto& window = m_windows[key];
+        if (window.samples.size() < m_windowSize)
+        {
+            window.samples.push_back(latency);
+        }
+        else
+        {
+            window.samples[window.next] = latency;
+        }
+        window.next = (window.next + 1) % m_windowSize;
+    }
+
+    /// @param percentile in range [0.0, 1.0], e.g., 0.95 for p95
+    /// @param minSamples estimates from fewer samples are not considered meaningful
+    /// @return latency percentile; std::nullopt if there are not enough samples for `key`
+    std::optional<Duration> getPercentile(std::string const& key, double percentile, std::size_t minSamples = 1U) const
+    {
+        std::vector<Duration> samples;
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            const auto it = m_windows.find(key);
+            if (it == m_windows.end() || it->second.samples.size() < std::max<std::size_t>(minSamples, 1U))
+            {
+                return std::nullopt;
+            }
+            samples = it->second.samples;
+        }
+
+        const auto rank = static_cast<std::size_t>(std::ceil(std::clamp(percentile, 0., 1.) * samples.size()));
+        const auto nth = samples.begin() + std::max<std::size_t>(rank, 1U) - 1;
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    }
+
+private:
+    struct Window
+    {
+        std::vector<Duration> samples;
+        std::size_t next{0U}; // ring buffer position to be overwritten next
+    };
+
+    const std::size_t m_windowSize;
+    std::unordered_map<std::string, Window> m_windows;
+    mutable std::mutex m_mtx;
+};
+
+} // namespace capybot
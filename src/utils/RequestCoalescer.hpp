@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace capybot
+{
+
+/**
+ * @brief Coalesces concurrent executions of identical requests (a.k.a. singleflight).
+ *
+ * The first caller for a key executes the request; callers arriving while it is in flight block and share its result.
+ * Optionally, results are cached for `cacheTtl` after completion, so calls within that window do not execute at all.
+ * Exceptions are forwarded to all waiters and never cached.
+ *
+ * @tparam ResultT request result type
+ */
+template <typename ResultT>
+class RequestCoalescer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestCoalescer(Clock::duration cacheTtl = Clock::duration::zero())
+        : m_cacheTtl(cacheTtl)
+    {
+    }
+
+    RequestCoalescer(const RequestCoalescer&) = delete;
+    RequestCoalescer& operator=(const RequestCoalescer&) = delete;
+
+    /// @brief execute `request`, or wait for the result of an identical one (same `key`) in flight or cached
+    ResultT execute(std::string const& key, std::function<ResultT()> const& request)
+    {
+        std::promise<ResultT> promise;
+        {
+            std::unique_lock<std::mutex> lk(m_mtx);
+
+            const auto now = Clock::now();
+            purgeExpired(now);
+
+            const auto it = m_calls.find(key);
+            if (it != m_calls.end())
+            {
+                if (!it->second.expiry.has_value() || now < it->second.expiry.value()) // in flight or cached
+                {
+                    auto future = it->second.result;
+                    lk.unlock();
+                    return future.get();
+                }
+                m_calls.erase(it);
+            }
+            m_calls.emplace(key, Call{.result = promise.get_future().share(), .expiry = std::nullopt});
+        }
+
+        bool failed{false};
+        try
+        {
+            promise.set_value(request());
+        }
+        catch (...)
+        {
+            failed = true;
+            promise.set_exception(std::current_exception());
+        }
+
+        std::shared_future<ResultT> future;
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            auto it = m_calls.find(key);
+            future = it->second.result;
+            if (failed || m_cacheTtl <= Clock::duration::zero())
+            {
+                m_calls.erase(it);
+            }
+            else
+            {
+                it->second.expiry = Clock::now() + m_cacheTtl;
+            }
+        }
+        return future.get();
+    }
+
+    /// @return number of requests in flight or cached
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return m_calls.size();
+    }
+
+private:
+    struct Call
+    {
+        std::shared_future<ResultT> result;
+        std::optional<Clock::time_point> expiry; // set once completed, if cached
+    };
+
+    /// @brief [lock(mutex)] drop expired cache entries; amortized, runs at most once per TTL
+    void purgeExpired(Clock::time_point now)
+    {
+        if (m_cacheTtl <= Clock::duration::zero() || now < m_nextPurge)
+        {
+            return;
+        }
+        std::erase_if(m_calls, [&now](auto const& entry) {
+            return entry.second.expiry.has_value() && entry.second.expiry.value() <= now;
+        });
+        m_nextPurge = now + m_cacheTtl;
+    }
+
+    const Clock::duration m_cacheTtl;
+    Clock::time_point m_nextPurge{};
+    std::unordered_map<std::string, Call> m_calls;
+    mutable std::mutex m_mtx;
+};
+
+} // namespace capybot
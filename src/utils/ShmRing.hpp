@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace capybot
+{
+
+/**
+ * @brief Bounded multi-producer single-consumer queue of messages in POSIX shared memory (`shm_open`), so processes on
+ * the same host can exchange messages without syscalls once attached.
+ *
+ * The region is a header followed by `slotCount` fixed size slots, each holding one message of up to `slotSize` bytes
+ * and a type tag. Producers claim slots with a CAS on the enqueue position and publish them with the slot sequence
+ * number (bounded MPMC queue by D. Vyukov); the consumer releases them the same way. A producer that dies between
+ * claiming and publishing a slot blocks the consumer at that slot, so the ring must be recreated.
+ *
+ * Any process that can open the region can write to it, so the ring shape is kept in process-local copies (taken when
+ * creating or opening the ring) and the consumer drops messages whose size does not fit in a slot.
+ */
+class ShmRing
+{
+public:
+    static constexpr uint32_t MAGIC{0x424E5452U}; // "BNTR"
+    static constexpr uint32_t VERSION{1U};
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    ~ShmRing()
+    {
+        ::munmap(m_region, m_regionSize);
+        if (m_isOwner)
+        {
+            ::shm_unlink(m_name.c_str());
+        }
+    }
+
+    /**
+     * @brief create the ring `name` (e.g., "/bnet_ingress"), replacing any existing one. It is removed when the
+     * returned object is destroyed.
+     * @param slotCount power of 2
+     * @param slotSize max message size, in bytes
+     * @param mode permissions of the shared memory object; if not set, read-write for all minus the umask
+     */
+    static std::unique_ptr<ShmRing> create(std::string const& name, uint32_t slotCount, uint32_t slotSize,
+                                           std::optional<mode_t> mode = std::nullopt)
+    {
+        if (slotCount < 2U || (slotCount & (slotCount - 1U)) != 0U || slotSize == 0U)
+        {
+            throw std::invalid_argument("ShmRing::create: slot count must be a power of 2 and slot size positive.");
+        }
+
+        ::shm_unlink(name.c_str()); // stale ring of a previous run
+        const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+        if (fd < 0)
+        {
+            throw std::runtime_error("ShmRing::create: shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+        if (mode.has_value() && ::fchmod(fd, mode.value()) != 0)
+        {
+            const int error{errno};
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("ShmRing::create: fchmod failed for " + name + ": " + std::strerror(error));
+        }
+
+        const auto slotStride = getSlotStride(slotSize);
+        const auto regionSize = sizeof(Header) + static_cast<std::size_t>(slotCount) * slotStride;
+        void* region{MAP_FAILED};
+        if (::ftruncate(fd, static_cast<off_t>(regionSize)) == 0)
+        {
+            region = ::mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        const int error{errno};
+        ::close(fd);
+        if (region == MAP_FAILED)
+        {
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("ShmRing::create: failed to map " + name + ": " + std::strerror(error));
+        }
+
+        auto* header = new (region) Header{};
+        header->slotCount = slotCount;
+        header->slotSize = slotSize;
+        auto ring = std::unique_ptr<ShmRing>(new ShmRing(name, region, regionSize, true, slotCount, slotSize));
+        for (uint32_t i = 0U; i < slotCount; ++i)
+        {
+            new (ring->getSlot(i)) SlotHeader{};
+            ring->getSlot(i)->sequence.store(i, std::memory_order_relaxed);
+        }
+        header->magic.store(MAGIC, std::memory_order_release); // producers attach only after this
+        return ring;
+    }
+
+    /// @brief attach to the ring `name`, e.g., from a producer process
+    static std::unique_ptr<ShmRing> open(std::string const& name)
+    {
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("ShmRing::open: shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+
+        struct stat fileStat;
+        void* region{MAP_FAILED};
+        if (::fstat(fd, &fileStat) == 0 && static_cast<std::size_t>(fileStat.st_size) >= sizeof(Header))
+        {
+            region = ::mmap(nullptr, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (region == MAP_FAILED)
+        {
+            throw std::runtime_error("ShmRing::open: failed to map " + name + ".");
+        }
+
+        const auto regionSize = static_cast<std::size_t>(fileStat.st_size);
+        const auto* header = static_cast<const Header*>(region);
+        const bool isInitialized{header->magic.load(std::memory_order_acquire) == MAGIC};
+        const uint32_t slotCount{header->slotCount};
+        const uint32_t slotSize{header->slotSize};
+        if (!isInitialized || header->version != VERSION || slotCount < 2U || (slotCount & (slotCount - 1U)) != 0U ||
+            sizeof(Header) + static_cast<std::size_t>(slotCount) * getSlotStride(slotSize) > regionSize)
+        {
+            ::munmap(region, regionSize);
+            throw std::runtime_error("ShmRing::open: " + name + " is not a ring, or not initialized yet.");
+        }
+        return std::unique_ptr<ShmRing>(new ShmRing(name, region, regionSize, false, slotCount, slotSize));
+    }
+
+    std::size_t getMaxMessageSize() const { return m_slotSize; }
+
+    std::size_t getCapacity() const { return m_slotCount; }
+
+    /// @return the number of messages `drain` dropped because their size was corrupted
+    std::size_t getDroppedCount() const { return m_droppedCount; }
+
+    /// @return false if the ring is full
+    /// @throw std::length_error if `data` is larger than `getMaxMessageSize()`
+    bool tryPush(uint8_t type, std::string_view data)
+    {
+        if (data.size() > m_slotSize)
+        {
+            throw std::length_error("ShmRing::tryPush: message larger than the slot size.");
+        }
+
+        auto pos = m_header->enqueuePos.load(std::memory_order_relaxed);
+        SlotHeader* slot;
+        while (true)
+        {
+            slot = getSlot(pos);
+            const auto sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<int64_t>(sequence - pos);
+            if (diff == 0)
+            {
+                if (m_header->enqueuePos.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // not released by the consumer yet
+            }
+            else
+            {
+                pos = m_header->enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->type = type;
+        slot->size = static_cast<uint32_t>(data.size());
+        std::memcpy(reinterpret_cast<char*>(slot) + sizeof(SlotHeader), data.data(), data.size());
+        slot->sequence.store(pos + 1U, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief single consumer: call `func(uint8_t type, std::string_view data)` for up to `maxMessages` published
+     * messages, in order. `data` is only valid during the call. Messages larger than the slot size are dropped, see
+     * `getDroppedCount()`.
+     * @return the number of messages consumed, including dropped ones
+     */
+    template <typename FuncT>
+    std::size_t drain(FuncT&& func, std::size_t maxMessages = std::numeric_limits<std::size_t>::max())
+    {
+        std::size_t count{0U};
+        auto pos = m_header->dequeuePos.load(std::memory_order_relaxed);
+        for (; count < maxMessages; ++count, ++pos)
+        {
+            auto* slot = getSlot(pos);
+            if (slot->sequence.load(std::memory_order_acquire) != pos + 1U)
+            {
+                break; // empty, or claimed but not published yet
+            }
+            // read once: a producer may still (wrongly) write to the slot
+            const uint32_t size{slot->size};
+            const uint8_t type{slot->type};
+            if (size > m_slotSize)
+            {
+                ++m_droppedCount;
+                release(slot, pos);
+                continue;
+            }
+            try
+            {
+                const auto* data = reinterpret_cast<const char*>(slot) + sizeof(SlotHeader);
+                func(type, std::string_view(data, size));
+            }
+            catch (...)
+            {
+                release(slot, pos);
+                throw;
+            }
+            release(slot, pos);
+        }
+        return count;
+    }
+
+private:
+    static constexpr std::size_t CACHE_LINE_SIZE{64U};
+
+    struct Header
+    {
+        std::atomic<uint32_t> magic{0U};
+        uint32_t version{VERSION};
+        uint32_t slotCount{0U};
+        uint32_t slotSize{0U};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueuePos{0U};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeuePos{0U};
+    };
+
+    struct SlotHeader
+    {
+        std::atomic<uint64_t> sequence{0U};
+        uint32_t size{0U};
+        uint8_t type{0U};
+    };
+
+    // atomics are shared between processes, which requires them to be lock free
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+
+    ShmRing(std::string name, void* region, std::size_t regionSize, bool isOwner, uint32_t slotCount,
+            uint32_t slotSize)
+        : m_name(std::move(name))
+        , m_region(region)
+        , m_regionSize(regionSize)
+        , m_isOwner(isOwner)
+        , m_header(static_cast<Header*>(region))
+        , m_slots(static_cast<char*>(region) + sizeof(Header))
+        , m_slotCount(slotCount)
+        , m_slotSize(slotSize)
+        , m_slotStride(getSlotStride(slotSize))
+    {
+    }
+
+    static std::size_t getSlotStride(uint32_t slotSize)
+    {
+        const auto size = sizeof(SlotHeader) + slotSize;
+        return (size + CACHE_LINE_SIZE - 1U) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+
+    SlotHeader* getSlot(uint64_t pos) const
+    {
+        return reinterpret_cast<SlotHeader*>(m_slots + (pos & (m_slotCount - 1U)) * m_slotStride);
+    }
+
+    void release(SlotHeader* slot, uint64_t pos)
+    {
+        slot->sequence.store(pos + m_slotCount, std::memory_order_release);
+        m_header->dequeuePos.store(pos + 1U, std::memory_order_relaxed);
+    }
+
+    const std::string m_name;
+    void* const m_region;
+    const std::size_t m_regionSize;
+    const bool m_isOwner;
+    Header* const m_header;
+    char* const m_slots;
+    const uint32_t m_slotCount;
+    const uint32_t m_slotSize;
+    const std::size_t m_slotStride;
+    std::size_t m_droppedCount{0U};
+};
+
+} // namespace capybot
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace capybot
+{
+
+/**
+ * @brief Hierarchical timing wheel for running callbacks once a deadline is reached.
+ *
+ * Timers are registered once and only touched again when time reaches their wheel slot, so pending timers cost nothing
+ * while the wheel advances. The wheel has no thread of its own; it is driven by `advance(now)` calls (e.g., once per
+ * controller epoch) and expired callbacks are executed within that call, outside the internal lock, so callbacks may
+ * schedule or cancel other timers.
+ *
+ * With the default 1 ms tick, the NUMBER_LEVELS x SLOTS_PER_LEVEL wheel covers ~4.6 hours. Longer timers are parked in
+ * an overflow list and moved into the wheel once they come within range.
+ */
+class TimingWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+
+    static constexpr TimerId INVALID_TIMER_ID{0UL};
+
+    explicit TimingWheel(Clock::duration tickDuration = std::chrono::milliseconds(1),
+                         Clock::time_point start = Clock::now())
+        : m_tickDuration(tickDuration)
+        , m_start(start)
+    {
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    /// @brief register `callback` to be executed by the first `advance` call at or past `deadline`
+    /// @return id that can be used for cancelling the timer
+    TimerId schedule(Clock::time_point deadline, Callback callback)
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+
+        const TimerId id = ++m_lastTimerId;
+        const uint64_t expiryTick = std::max(toTickCeil(deadline), m_currentTick + 1); // past deadlines: next tick
+
+        auto& slot = getSlot(expiryTick);
+        slot.push_back(Timer{.id = id, .expiryTick = expiryTick, .callback = std::move(callback), .slot = &slot});
+        m_timers.emplace(id, std::prev(slot.end()));
+        return id;
+    }
+
+    /// @return true if the timer was pending and has been cancelled; false if it has already expired or does not exist
+    bool cancel(TimerId id)
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+
+        const auto it = m_timers.find(id);
+        if (it == m_timers.end())
+        {
+            return false;
+        }
+        it->second->slot->erase(it->second);
+        m_timers.erase(it);
+        return true;
+    }
+
+    /// @brief move the wheel forward to `now`, executing the callbacks of all expired timers
+    void advance(Clock::time_point now)
+    {
+        std::vector<Callback> expired;
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+
+            const uint64_t targetTick = toTickFloor(now);
+            while (m_currentTick < targetTick)
+            {
+                if (m_timers.empty()) // nothing to expire, fast-forward
+                {
+                    m_currentTick = targetTick;
+                    break;
+                }
+
+                ++m_currentTick;
+                cascade();
+
+                auto& slot = m_wheel[0][m_currentTick & SLOT_MASK];
+                for (auto&& timer : slot)
+                {
+                    expired.push_back(std::move(timer.callback));
+                    m_timers.erase(timer.id);
+                }
+                slot.clear();
+            }
+        }
+
+        for (auto&& callback : expired)
+        {
+            callback();
+        }
+    }
+
+    /// @return number of pending timers
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        return m_timers.size();
+    }
+
+private:
+    static constexpr uint32_t BITS_PER_LEVEL{6U};
+    static constexpr uint32_t NUMBER_LEVELS{4U};
+    static constexpr uint64_t SLOTS_PER_LEVEL{1UL << BITS_PER_LEVEL};
+    static constexpr uint64_t SLOT_MASK{SLOTS_PER_LEVEL - 1};
+
+    struct Timer
+    {
+        TimerId id;
+        uint64_t expiryTick;
+        Callback callback;
+        std::list<Timer>* slot; // list currently holding the timer; needed for cancelling
+    };
+    using Slot = std::list<Timer>;
+
+    uint64_t toTickFloor(Clock::time_point t) const { return t <= m_start ? 0UL : (t - m_start) / m_tickDuration; }
+    uint64_t toTickCeil(Clock::time_point t) const
+    {
+        return t <= m_start ? 0UL : (t - m_start + m_tickDuration - Clock::duration(1)) / m_tickDuration;
+    }
+
+    /// @brief slot for a timer expiring at `expiryTick` (>= m_currentTick), given the current wheel position
+    Slot& getSlot(uint64_t expiryTick)
+    {
+        const uint64_t delta = expiryTick - m_currentTick;
+        for (uint32_t level = 0; level < NUMBER_LEVELS; ++level)
+        {
+            if (delta < (1UL << (BITS_PER_LEVEL * (level + 1))))
+            {
+                return m_wheel[level][(expiryTick >> (BITS_PER_LEVEL * level)) & SLOT_MASK];
+            }
+        }
+        return m_overflow;
+    }
+
+    /// @brief re-insert all timers from `slot` according to the current wheel position
+    void redistribute(Slot& slot)
+    {
+        Slot pending;
+        pending.swap(slot);
+        while (!pending.empty())
+        {
+            auto& target = getSlot(pending.front().expiryTick);
+            pending.front().slot = &target;
+            target.splice(target.end(), pending, pending.begin()); // iterators in `m_timers` stay valid
+        }
+    }
+
+    /// @brief move timers from higher levels down when the lower levels wrap around
+    void cascade()
+    {
+        const auto isLevelBoundary = [this](uint32_t level) {
+            return (m_currentTick & ((1UL << (BITS_PER_LEVEL * level)) - 1)) == 0;
+        };
+
+        if (isLevelBoundary(NUMBER_LEVELS - 1))
+        {
+            redistribute(m_overflow);
+        }
+        for (uint32_t level = NUMBER_LEVELS - 1; level > 0; --level)
+        {
+            if (isLevelBoundary(level))
+            {
+                redistribute(m_wheel[level][(m_currentTick >> (BITS_PER_LEVEL * level)) & SLOT_MASK]);
+            }
+        }
+    }
+
+    const Clock::duration m_tickDuration;
+    const Clock::time_point m_start;
+
+    uint64_t m_currentTick{0UL}; // all ticks up to (and including) this one have been processed
+    TimerId m_lastTimerId{INVALID_TIMER_ID};
+
+    std::array<std::array<Slot, SLOTS_PER_LEVEL>, NUMBER_LEVELS> m_wheel;
+    Slot m_overflow;
+    std::unordered_map<TimerId, Slot::iterator> m_timers;
+
+    mutable std::mutex m_mtx;
+};
+
+} // namespace capybot
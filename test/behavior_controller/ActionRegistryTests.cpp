@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/ActionRegistry.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Action types can be loaded from plugins", "[BehaviorController/ActionRegistry]")
+{
+    bnet::ThreadPool tp(2);
+
+    REQUIRE_THROWS(bnet::ActionRegistry::create(tp, "PluginTestAction", nlohmann::json{{"result", "FAILURE"}}));
+    REQUIRE_THROWS(bnet::ActionRegistry::loadPlugin("test/behavior_controller/libnot_a_plugin.so"));
+
+    bnet::ActionRegistry::loadPlugin("test/behavior_controller/libtest_action_plugin.so");
+    REQUIRE_NOTHROW(bnet::ActionRegistry::loadPlugin("test/behavior_controller/libtest_action_plugin.so"));
+
+    auto action = bnet::ActionRegistry::create(tp, "PluginTestAction", nlohmann::json{{"result", "FAILURE"}});
+    action->executeAsync({bnet::Token::makeShared()});
+    std::this_thread::sleep_for(50ms);
+    const auto results = action->getEpochResults();
+    REQUIRE(results.size() == 1);
+    REQUIRE(results.front().status == +bnet::ActionExecutionStatus::FAILURE);
+}
@@ -18,11 +18,595 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <behavior_net/Action.hpp>
+#include <behavior_net/action_impl/HttpGetAction.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <thread>
+#include <tuple>
 
 using namespace capybot;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/// @brief always in progress; asks not to be executed again for `pollPeriod`
+class PollingActionImpl : public bnet::IActionImpl
+{
+public:
+    explicit PollingActionImpl(std::chrono::milliseconds pollPeriod, std::atomic_int& executions)
+        : m_pollPeriod(pollPeriod)
+        , m_executions(executions)
+    {
+    }
+
+    std::function<bnet::ActionExecutionStatus()> createCallable(bnet::Token::ConstSharedPtr token) override
+    {
+        return [this]() -> bnet::ActionExecutionStatus {
+            ++m_executions;
+            return bnet::ActionExecutionStatus::IN_PROGRESS;
+        };
+    }
+
+    std::optional<TimingWheel::Clock::time_point> getNextExecutionTime(bnet::Token::ConstSharedPtr const&) override
+    {
+        return TimingWheel::Clock::now() + m_pollPeriod;
+    }
+
+private:
+    std::chrono::milliseconds m_pollPeriod;
+    std::atomic_int& m_executions;
+};
+
+/// @brief takes `duration` to succeed; all executions share the same concurrency key
+class SlowActionImpl : public bnet::IActionImpl
+{
+public:
+    explicit SlowActionImpl(std::chrono::milliseconds duration, std::atomic_int& executions)
+        : m_duration(duration)
+        , m_executions(executions)
+    {
+    }
+
+    std::function<bnet::ActionExecutionStatus()> createCallable(bnet::Token::ConstSharedPtr token) override
+    {
+        return [this]() -> bnet::ActionExecutionStatus {
+            ++m_executions;
+            std::this_thread::sleep_for(m_duration.load());
+            return bnet::ActionExecutionStatus::SUCCESS;
+        };
+    }
+
+    std::optional<std::string> getConcurrencyKey(bnet::Token::ConstSharedPtr const&) override { return "host:80"; }
+
+    void cancel(bnet::Token::ConstSharedPtr const&) override { ++cancellations; }
+
+    void setDuration(std::chrono::milliseconds duration) { m_duration = duration; }
+
+    std::atomic_int cancellations{0};
+
+private:
+    std::atomic<std::chrono::milliseconds> m_duration;
+    std::atomic_int& m_executions;
+};
+
+/// @brief results in error `failures` times, then succeeds
+class FlakyActionImpl : public bnet::IActionImpl
+{
+public:
+    explicit FlakyActionImpl(int failures, std::atomic_int& executions)
+        : m_failures(failures)
+        , m_executions(executions)
+    {
+    }
+
+    std::function<bnet::ActionExecutionStatus()> createCallable(bnet::Token::ConstSharedPtr token) override
+    {
+        return [this]() -> bnet::ActionExecutionStatus {
+            return ++m_executions <= m_failures ? bnet::ActionExecutionStatus::ERROR
+                                                : bnet::ActionExecutionStatus::SUCCESS;
+        };
+    }
+
+private:
+    int m_failures;
+    std::atomic_int& m_executions;
+};
+
+/// @brief executes all tokens at once; every other token fails
+class BatchActionImpl : public bnet::IActionImpl
+{
+public:
+    bool supportsBatchExecution() const override { return true; }
+
+    std::function<std::vector<bnet::ActionExecutionStatus>()> createBatchCallable(
+        std::vector<bnet::Token::ConstSharedPtr> const& tokens) override
+    {
+        return [this, numberTokens = tokens.size()]() {
+            ++batchExecutions;
+            std::vector<bnet::ActionExecutionStatus> statuses;
+            for (std::size_t i = 0U; i < numberTokens; ++i)
+            {
+                statuses.push_back(i % 2 == 0 ? bnet::ActionExecutionStatus::SUCCESS
+                                              : bnet::ActionExecutionStatus::FAILURE);
+            }
+            return statuses;
+        };
+    }
+
+    std::atomic_int batchExecutions{0};
+};
+
+} // namespace
+
+TEST_CASE("Batch implementations execute all tokens in a single call", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(2);
+    auto batchImpl = std::make_unique<BatchActionImpl>();
+    auto& batchExecutions = batchImpl->batchExecutions;
+    std::unique_ptr<bnet::IActionImpl> impl = std::move(batchImpl);
+    bnet::Action action(tp, impl);
+
+    std::list<bnet::Token::SharedPtr> tokens;
+    for (int i = 0; i < 4; ++i)
+    {
+        tokens.push_back(bnet::Token::makeShared());
+    }
+
+    action.executeAsync(tokens);
+    std::this_thread::sleep_for(50ms);
+    const auto results = action.getEpochResults();
+    REQUIRE(batchExecutions == 1);
+    REQUIRE(results.size() == 4);
+
+    // statuses are matched to tokens by position
+    auto tokenIt = tokens.begin();
+    for (std::size_t i = 0U; i < results.size(); ++i, ++tokenIt)
+    {
+        REQUIRE(results[i].tokenPtr == *tokenIt);
+        REQUIRE(results[i].status == (i % 2 == 0 ? +bnet::ActionExecutionStatus::SUCCESS
+                                                 : +bnet::ActionExecutionStatus::FAILURE));
+    }
+}
+
+TEST_CASE("Cheap callables are executed in chunks", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(2);
+    std::atomic_int executions{0};
+    auto slowImpl = std::make_unique<SlowActionImpl>(0ms, executions);
+    auto* actionImpl = slowImpl.get();
+    std::unique_ptr<bnet::IActionImpl> impl = std::move(slowImpl);
+    bnet::Action action(tp, impl);
+
+    constexpr int NUMBER_TOKENS{1000};
+    std::list<bnet::Token::SharedPtr> tokens;
+    for (int i = 0; i < NUMBER_TOKENS; ++i)
+    {
+        tokens.push_back(bnet::Token::makeShared());
+    }
+
+    // until execution times are measured, each token gets a task
+    REQUIRE(action.computeChunkSize(NUMBER_TOKENS) == 1U);
+
+    // the first epoch measures execution times; next ones are chunked into fewer tasks than tokens, at most an even
+    // share of the tokens per worker
+    for (int epoch = 1; epoch <= 3; ++epoch)
+    {
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(100ms);
+        REQUIRE(action.getEpochResults().size() == NUMBER_TOKENS);
+        REQUIRE(executions == epoch * NUMBER_TOKENS);
+        REQUIRE(action.computeChunkSize(NUMBER_TOKENS) > 1U);
+        REQUIRE(action.computeChunkSize(NUMBER_TOKENS) <= NUMBER_TOKENS / tp.getNumberWorkers());
+    }
+    const auto cheapChunkSize = action.computeChunkSize(NUMBER_TOKENS);
+
+    // a slow sample shrinks the chunks: slow callables get a task each
+    actionImpl->setDuration(5ms);
+    std::list<bnet::Token::SharedPtr> slowTokens{bnet::Token::makeShared()};
+    action.executeAsync(slowTokens);
+    std::this_thread::sleep_for(100ms);
+    REQUIRE(action.getEpochResults().size() == 1U);
+    REQUIRE(action.computeChunkSize(NUMBER_TOKENS) < cheapChunkSize);
+    REQUIRE(action.computeChunkSize(NUMBER_TOKENS) == 1U);
+}
+
+TEST_CASE("Failed executions are retried within the action", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(2);
+    std::atomic_int executions{0};
+    std::list<bnet::Token::SharedPtr> tokens{bnet::Token::makeShared()};
+
+    {
+        std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<FlakyActionImpl>(2, executions);
+        bnet::Action action(tp, impl, nlohmann::json{{"max_retries", 2}});
+        const auto runEpoch = [&] {
+            action.executeAsync(tokens);
+            std::this_thread::sleep_for(50ms);
+            return action.getEpochResults();
+        };
+
+        REQUIRE(runEpoch().empty());
+        REQUIRE(runEpoch().empty());
+        const auto results = runEpoch();
+        REQUIRE(results.size() == 1);
+        REQUIRE(results.front().status == +bnet::ActionExecutionStatus::SUCCESS);
+        REQUIRE(executions == 3);
+    }
+
+    // out of retries; retries wait for the backoff
+    executions = 0;
+    {
+        std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<FlakyActionImpl>(2, executions);
+        bnet::Action action(tp, impl, nlohmann::json{{"max_retries", 1}, {"retry_backoff_ms", 150}});
+        const auto runEpoch = [&] {
+            action.executeAsync(tokens);
+            std::this_thread::sleep_for(50ms);
+            return action.getEpochResults();
+        };
+
+        REQUIRE(runEpoch().empty());
+        REQUIRE(runEpoch().empty());
+        REQUIRE(executions == 1);
+
+        std::this_thread::sleep_for(100ms);
+        runEpoch(); // backoff expires
+        const auto results = runEpoch();
+        REQUIRE(results.size() == 1);
+        REQUIRE(results.front().status == +bnet::ActionExecutionStatus::ERROR);
+        REQUIRE(executions == 2);
+    }
+
+    // only the configured statuses are retried
+    executions = 0;
+    {
+        std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<FlakyActionImpl>(2, executions);
+        bnet::Action action(tp, impl, nlohmann::json{{"max_retries", 3}, {"retry_on", {"FAILURE"}}});
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(50ms);
+        const auto results = action.getEpochResults();
+        REQUIRE(results.size() == 1);
+        REQUIRE(results.front().status == +bnet::ActionExecutionStatus::ERROR);
+    }
+}
+
+TEST_CASE("Executions in flight are limited per action and per host", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(8);
+    std::atomic_int executions{0};
+
+    std::list<bnet::Token::SharedPtr> tokens;
+    for (int i = 0; i < 5; ++i)
+    {
+        tokens.push_back(bnet::Token::makeShared());
+    }
+
+    {
+        std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<SlowActionImpl>(200ms, executions);
+        bnet::Action action(tp, impl, nlohmann::json{{"max_in_flight", 2}});
+
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(50ms);
+        REQUIRE(action.getEpochResults().empty());
+        REQUIRE(executions == 2);
+
+        action.executeAsync(tokens); // still full
+        std::this_thread::sleep_for(250ms);
+        const auto results = action.getEpochResults();
+        REQUIRE(results.size() == 2);
+        REQUIRE(executions == 2);
+
+        for (auto&& result : results)
+        {
+            tokens.remove(result.tokenPtr);
+        }
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(250ms);
+        REQUIRE(action.getEpochResults().size() == 2);
+        REQUIRE(executions == 4);
+    }
+
+    // the per host limit is shared by all actions of the thread pool
+    executions = 0;
+    {
+        std::unique_ptr<bnet::IActionImpl> implA = std::make_unique<SlowActionImpl>(100ms, executions);
+        std::unique_ptr<bnet::IActionImpl> implB = std::make_unique<SlowActionImpl>(100ms, executions);
+        bnet::Action actionA(tp, implA, nlohmann::json{{"max_in_flight_per_host", 2}});
+        bnet::Action actionB(tp, implB, nlohmann::json{{"max_in_flight_per_host", 2}});
+
+        std::list<bnet::Token::SharedPtr> tokensA{bnet::Token::makeShared(), bnet::Token::makeShared()};
+        std::list<bnet::Token::SharedPtr> tokensB{bnet::Token::makeShared(), bnet::Token::makeShared()};
+
+        actionA.executeAsync(tokensA);
+        actionB.executeAsync(tokensB);
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(actionA.getEpochResults().size() == 2);
+        REQUIRE(actionB.getEpochResults().empty());
+        REQUIRE(executions == 2);
+
+        tokensA.clear();
+        actionA.executeAsync(tokensA);
+        actionB.executeAsync(tokensB);
+        std::this_thread::sleep_for(200ms);
+        REQUIRE(actionA.getEpochResults().empty());
+        REQUIRE(actionB.getEpochResults().size() == 2);
+        REQUIRE(executions == 4);
+    }
+    REQUIRE(tp.getConcurrencyLimiter().getInUse("host:80") == 0U);
+}
+
+TEST_CASE("Executions resolve to the timeout status once their deadline is exceeded", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(1);
+    std::atomic_int executions{0};
+    auto slowImpl = std::make_unique<SlowActionImpl>(300ms, executions);
+    auto& cancellations = slowImpl->cancellations;
+    std::unique_ptr<bnet::IActionImpl> impl = std::move(slowImpl);
+    bnet::Action action(tp, impl, nlohmann::json{{"timeout_ms", 100}, {"timeout_status", "FAILURE"}});
+
+    // the second token waits in the queue of the single worker
+    std::list<bnet::Token::SharedPtr> tokens{bnet::Token::makeShared(), bnet::Token::makeShared()};
+    action.executeAsync(tokens);
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(action.getEpochResults().empty());
+
+    std::this_thread::sleep_for(100ms);
+    const auto results = action.getEpochResults();
+    REQUIRE(results.size() == 2);
+    for (auto&& result : results)
+    {
+        REQUIRE(result.status == +bnet::ActionExecutionStatus::FAILURE);
+    }
+    REQUIRE(cancellations == 2);
+
+    // the queued execution is skipped once the running one returns
+    std::this_thread::sleep_for(300ms);
+    REQUIRE(action.getEpochResults().empty());
+    REQUIRE(executions == 1);
+
+    REQUIRE_THROWS(bnet::Action(tp, impl, nlohmann::json{{"timeout_status", "NOT_A_STATUS"}}));
+}
+
+TEST_CASE("HttpGetAction only accepts a final status while the circuit is open", "[BehaviorController/Action]")
+{
+    nlohmann::json config{{"host", "localhost"},
+                          {"port", 80},
+                          {"execute_path", "/execute"},
+                          {"get_status_path", "/status"},
+                          {"circuit_breaker_threshold", 1}};
+
+    for (auto&& status : {"SUCCESS", "FAILURE", "ERROR"})
+    {
+        config["circuit_open_status"] = status;
+        REQUIRE_NOTHROW(bnet::HttpGetAction(config));
+    }
+
+    // tokens would never leave the place
+    for (auto&& status : {"NOT_STARTED", "IN_PROGRESS", "QUERRY_TIMEOUT", "NOT_A_STATUS"})
+    {
+        config["circuit_open_status"] = status;
+        try
+        {
+            bnet::HttpGetAction action(config);
+            FAIL("HttpGetAction accepted circuit_open_status " << status);
+        }
+        catch (bnet::Exception& e)
+        {
+            REQUIRE(e.type() == +bnet::ExceptionType::INVALID_CONFIG_FILE);
+        }
+    }
+}
+
+TEST_CASE("HttpGetAction hedges slow status requests from its own workers", "[BehaviorController/Action]")
+{
+    std::atomic_int statusRequests{0};
+    std::atomic_bool isSlow{false};
+    httplib::Server agent;
+    agent.Get("/execute", [](httplib::Request const&, httplib::Response& res) {
+        res.set_content("IN_PROGRESS", "text/plain");
+    });
+    agent.Get("/status", [&](httplib::Request const&, httplib::Response& res) {
+        if (statusRequests++ == 0 && isSlow)
+        {
+            std::this_thread::sleep_for(1s); // only the first request is slow
+        }
+        res.set_content("IN_PROGRESS", "text/plain");
+    });
+    const int port = agent.bind_to_any_port("127.0.0.1");
+    std::thread agentThread([&agent]() { agent.listen_after_bind(); });
+    while (!agent.is_running())
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    {
+        bnet::HttpGetAction action(nlohmann::json{{"host", "127.0.0.1"},
+                                                  {"port", port},
+                                                  {"execute_path", "/execute"},
+                                                  {"get_status_path", "/status"},
+                                                  {"hedge_status_requests", true},
+                                                  {"max_hedged_requests", 1}});
+        auto callable = action.createCallable(bnet::Token::makeShared());
+        for (int i = 0; i < 30; ++i) // learn the host latency
+        {
+            REQUIRE(callable() == +bnet::ActionExecutionStatus::IN_PROGRESS);
+        }
+
+        statusRequests = 0;
+        isSlow = true;
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(callable() == +bnet::ActionExecutionStatus::IN_PROGRESS);
+        REQUIRE(std::chrono::steady_clock::now() - start < 500ms); // the backup request won
+        REQUIRE(statusRequests == 2);
+    } // joins the hedging worker
+
+    agent.stop();
+    agentThread.join();
+}
+
+TEST_CASE("HttpGetAction forgets the executions of cancelled tokens", "[BehaviorController/Action]")
+{
+    std::atomic_int executeRequests{0};
+    std::atomic_bool isSlow{false};
+    httplib::Server agent;
+    agent.Get("/execute", [&](httplib::Request const&, httplib::Response& res) {
+        ++executeRequests;
+        if (isSlow)
+        {
+            std::this_thread::sleep_for(200ms);
+        }
+        res.set_content("IN_PROGRESS", "text/plain");
+    });
+    agent.Get("/status", [](httplib::Request const&, httplib::Response& res) {
+        res.set_content("IN_PROGRESS", "text/plain");
+    });
+    const int port = agent.bind_to_any_port("127.0.0.1");
+    std::thread agentThread([&agent]() { agent.listen_after_bind(); });
+    while (!agent.is_running())
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    {
+        bnet::HttpGetAction action(nlohmann::json{
+            {"host", "127.0.0.1"}, {"port", port}, {"execute_path", "/execute"}, {"get_status_path", "/status"}});
+
+        // never executed: nothing to forget
+        action.cancel(bnet::Token::makeShared());
+        REQUIRE(action.getNumberTrackedExecutions() == 0U);
+
+        // cancelled between polls
+        auto token = bnet::Token::makeShared();
+        REQUIRE(action.createCallable(token)() == +bnet::ActionExecutionStatus::IN_PROGRESS);
+        REQUIRE(action.getNumberTrackedExecutions() == 1U);
+        action.cancel(token);
+        REQUIRE(action.getNumberTrackedExecutions() == 0U);
+
+        // cancelled while its request is in flight
+        isSlow = true;
+        token = bnet::Token::makeShared();
+        std::thread execution([callable = action.createCallable(token)] { callable(); });
+        std::this_thread::sleep_for(50ms);
+        action.cancel(token);
+        execution.join();
+        REQUIRE(action.getNumberTrackedExecutions() == 0U);
+        REQUIRE(executeRequests == 2); // each token started over with an execute request
+    }
+
+    agent.stop();
+    agentThread.join();
+}
+
+TEST_CASE("Destroying an HttpGetAction interrupts its requests in flight", "[BehaviorController/Action]")
+{
+    std::atomic_bool isReleased{false};
+    httplib::Server agent;
+    agent.Get("/execute", [&](httplib::Request const&, httplib::Response& res) {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (!isReleased && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        res.set_content("IN_PROGRESS", "text/plain");
+    });
+    const int port = agent.bind_to_any_port("127.0.0.1");
+    std::thread agentThread([&agent]() { agent.listen_after_bind(); });
+    while (!agent.is_running())
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    bnet::ThreadPool tp(1);
+    std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<bnet::HttpGetAction>(
+        nlohmann::json{{"host", "127.0.0.1"},
+                       {"port", port},
+                       {"execute_path", "/execute"},
+                       {"get_status_path", "/status"},
+                       {"request_timeout_ms", 5000}});
+    auto action = std::make_unique<bnet::Action>(tp, impl);
+    action->executeAsync({bnet::Token::makeShared()});
+    std::this_thread::sleep_for(50ms); // the request is in flight
+    REQUIRE(action->getEpochResults().empty());
+
+    const auto start = std::chrono::steady_clock::now();
+    action.reset();
+    REQUIRE(std::chrono::steady_clock::now() - start < 1s);
+
+    isReleased = true;
+    agent.stop();
+    agentThread.join();
+}
+
+TEST_CASE("In progress actions are not executed again before the requested time", "[BehaviorController/Action]")
+{
+    bnet::ThreadPool tp(2);
+    std::atomic_int executions{0};
+    std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<PollingActionImpl>(300ms, executions);
+    bnet::Action action(tp, impl);
+
+    std::list<bnet::Token::SharedPtr> tokens{bnet::Token::makeShared()};
+    const auto runEpoch = [&] {
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(50ms);
+        return action.getEpochResults();
+    };
+
+    const auto results = runEpoch();
+    REQUIRE(results.size() == 1);
+    REQUIRE(results.front().status == +bnet::ActionExecutionStatus::IN_PROGRESS);
+    REQUIRE(executions == 1);
+
+    // deferred: not executed while waiting
+    REQUIRE(runEpoch().empty());
+    REQUIRE(runEpoch().empty());
+    REQUIRE(executions == 1);
+    REQUIRE(action.getNumberDelayedTasks() == 1);
+
+    // executed again once the time is reached
+    std::this_thread::sleep_for(250ms);
+    runEpoch(); // timer expires
+    runEpoch();
+    REQUIRE(executions == 2);
+}
+
+TEST_CASE("Deferred tokens are executed on the first poll at or after their time", "[BehaviorController/Action]")
+{
+    constexpr auto DEFERRAL{100ms};
+    constexpr auto POLL_PERIOD{30ms};
+    bnet::ThreadPool tp(2);
+    std::atomic_int executions{0};
+    std::unique_ptr<bnet::IActionImpl> impl = std::make_unique<PollingActionImpl>(DEFERRAL, executions);
+    bnet::Action action(tp, impl);
+    std::list<bnet::Token::SharedPtr> tokens{bnet::Token::makeShared()};
+
+    // polled like the controller does: results of the previous poll first, then executions
+    action.executeAsync(tokens);
+    std::this_thread::sleep_for(POLL_PERIOD);
+    const auto deferredFrom = TimingWheel::Clock::now();
+    REQUIRE(action.getEpochResults().size() == 1);
+    const auto deferredTo = TimingWheel::Clock::now();
+    action.executeAsync(tokens);
+    REQUIRE(executions == 1);
+
+    while (executions == 1 && TimingWheel::Clock::now() < deferredTo + 10 * DEFERRAL)
+    {
+        std::this_thread::sleep_for(POLL_PERIOD);
+        const auto pollTime = TimingWheel::Clock::now();
+        std::ignore = action.getEpochResults();
+        action.executeAsync(tokens);
+        std::this_thread::sleep_for(5ms); // the execution is a counter increment
+        if (pollTime < deferredFrom + DEFERRAL)
+        {
+            REQUIRE(executions == 1);
+        }
+        else if (pollTime >= deferredTo + DEFERRAL + 2ms) // timing wheel ticks are 1 ms
+        {
+            REQUIRE(executions == 2); // in this same poll, not the next one
+        }
+    }
+    REQUIRE(executions == 2);
+}
 
 // TEST_CASE("Action execution works as expected.", "[BehaviorController/Action]")
 // {
@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/Config.hpp>
+#include <behavior_net/server_impl/HttpServer.hpp>
+#include <utils/Gzip.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace capybot;
+
+namespace
+{
+/// @brief unique per process, so concurrent test runs do not share sockets
+std::string createSocketPath(std::string const& name)
+{
+    const auto fileName = name + "_" + std::to_string(::getpid()) + ".sock";
+    return (std::filesystem::temp_directory_path() / fileName).string();
+}
+
+httplib::Client createUnixClient(std::string const& socketPath)
+{
+    httplib::Client client(socketPath, 80);
+    client.set_address_family(AF_UNIX);
+    return client;
+}
+
+/// @brief net with places "A" and "B", served by the http server of the controller on `socketPath`
+bnet::NetConfig createStreamNetConfig(std::string const& socketPath, uint32_t maxStreams)
+{
+    const nlohmann::json config{
+        {"config_metadata", {{"version", "0.1"}, {"id", ""}, {"authors", {""}}}},
+        {"petri_net",
+         {{"places", {{{"place_id", "A"}}, {{"place_id", "B"}}}}, {"transitions", nlohmann::json::array()}}},
+        {"controller",
+         {{"thread_poll_workers", 1},
+          {"epoch_period_ms", 10},
+          {"actions", nlohmann::json::array()},
+          {"http_server", {{"unix_socket_path", socketPath}, {"max_streams", maxStreams}}}}},
+        {"initial_marking", nlohmann::json::array()}};
+    const auto path = socketPath + ".json";
+    std::ofstream(path) << config.dump();
+    bnet::NetConfig netConfig(path);
+    std::filesystem::remove(path);
+    return netConfig;
+}
+
+/// @brief the controller starts its servers from its own thread
+void waitForServer(httplib::Client& client)
+{
+    for (int i = 0; i < 200 && !client.Get("/"); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+struct StreamEvent
+{
+    uint64_t id;
+    nlohmann::json data;
+};
+
+/// @brief read `/marking_stream` until `count` marking events are received, heartbeats are skipped
+std::vector<StreamEvent> readMarkingStream(httplib::Client& client, httplib::Headers const& headers, std::size_t count,
+                                           std::function<void(StreamEvent const&)> const& onEvent = nullptr)
+{
+    std::vector<StreamEvent> events;
+    std::string buffer;
+    client.Get("/marking_stream", headers, [&](const char* data, size_t length) {
+        buffer.append(data, length);
+        for (auto end = buffer.find("\n\n"); end != std::string::npos; end = buffer.find("\n\n"))
+        {
+            const auto message = buffer.substr(0, end);
+            buffer.erase(0, end + 2U);
+            if (message.starts_with("id: "))
+            {
+                auto& event = events.emplace_back();
+                event.id = std::stoull(message.substr(4U, message.find('\n') - 4U));
+                event.data = nlohmann::json::parse(message.substr(message.find("data: ") + 6U));
+                if (onEvent)
+                {
+                    onEvent(event);
+                }
+            }
+        }
+        return events.size() < count;
+    });
+    return events;
+}
+
+/// @brief a marking large enough to be worth compressing with the default "gzip_min_size"
+nlohmann::json const& getTestMarking()
+{
+    static const nlohmann::json marking = [] {
+        auto marking = nlohmann::json::object();
+        for (int i = 0; i < 200; ++i)
+        {
+            marking["P" + std::to_string(i)] = i % 3;
+        }
+        return marking;
+    }();
+    return marking;
+}
+
+/// @brief callbacks of a controller in which place "FULL" takes no tokens and "T1" is the only transition
+bnet::ControllerCallbacks createControllerCallbacks(std::vector<std::string>& addedPlaceIds)
+{
+    static const nlohmann::json config{{"petri_net", nlohmann::json::object()}};
+    auto addToken = [&addedPlaceIds](std::string_view placeId) {
+        if (placeId == "FULL")
+        {
+            throw bnet::Exception(bnet::ExceptionType::CAPACITY_EXCEEDED, "place is full.");
+        }
+        addedPlaceIds.emplace_back(placeId);
+    };
+    return bnet::ControllerCallbacks{
+        .addToken = [addToken](nlohmann::json, std::string_view placeId, auto) { addToken(placeId); },
+        .addTokens =
+            [addToken](std::vector<bnet::TokenRequest> requests) {
+                bnet::BulkResults results;
+                for (auto&& request : requests)
+                {
+                    try
+                    {
+                        addToken(request.placeId);
+                        results.emplace_back(std::nullopt);
+                    }
+                    catch (std::exception const& e)
+                    {
+                        results.emplace_back(e.what());
+                    }
+                }
+                return results;
+            },
+        .getNetMarking = [](auto) { return nlohmann::json{{"version", 1}, {"marking", getTestMarking()}}; },
+        .getNetConfig = []() -> nlohmann::json const& { return config; },
+        .triggerManualTransition = [](auto) {},
+        .triggerManualTransitions =
+            [](std::vector<std::string> const& ids) {
+                bnet::BulkResults results;
+                for (auto&& id : ids)
+                {
+                    results.push_back(id == "T1" ? std::nullopt : std::optional<std::string>("unknown transition"));
+                }
+                return results;
+            },
+        .getMarkingUpdates = [](auto, auto) { return nlohmann::json::object(); }};
+}
+} // namespace
+
+TEST_CASE("The server listens on a Unix domain socket, replacing a stale socket file.",
+          "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_unix");
+
+    // a previous run that did not stop cleanly leaves its socket file behind
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    socketPath.copy(addr.sun_path, sizeof(addr.sun_path) - 1U);
+    const int staleFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(::bind(staleFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    ::close(staleFd);
+    REQUIRE(std::filesystem::is_socket(socketPath));
+
+    std::vector<std::string> addedPlaceIds;
+    bnet::HttpServer server({{"unix_socket_path", socketPath}, {"unix_socket_mode", "0660"}},
+                            createControllerCallbacks(addedPlaceIds));
+    server.start();
+
+    struct stat fileStat;
+    REQUIRE(::stat(socketPath.c_str(), &fileStat) == 0);
+    REQUIRE((fileStat.st_mode & 0777) == 0660);
+
+    auto client = createUnixClient(socketPath);
+    auto res = client.Get("/");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    REQUIRE(res->body == "You have reached bnet::capybot::HttpServer.");
+
+    server.stop();
+    REQUIRE_FALSE(std::filesystem::exists(socketPath));
+}
+
+TEST_CASE("Bulk endpoints report a result per item, in request order.", "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_bulk");
+    std::vector<std::string> addedPlaceIds;
+    bnet::HttpServer server({{"unix_socket_path", socketPath}}, createControllerCallbacks(addedPlaceIds));
+    server.start();
+    auto client = createUnixClient(socketPath);
+
+    // malformed items are rejected by the server, the others by the controller
+    auto res = client.Post("/add_tokens",
+                           R"([{"place_id": "A", "content_blocks": {}}, {"place_id": "A"},
+                               {"place_id": "FULL", "content_blocks": {}}, {"place_id": "B", "content_blocks": {}}])",
+                           "application/json");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    auto results = nlohmann::json::parse(res->body);
+    REQUIRE(results.size() == 4U);
+    REQUIRE(results.at(0) == nlohmann::json{{"success", true}});
+    REQUIRE(results.at(1).at("success") == false);
+    REQUIRE(results.at(1).at("error").get<std::string>().starts_with("invalid token"));
+    REQUIRE(results.at(2).at("success") == false);
+    REQUIRE(results.at(2).at("error").get<std::string>().find("full") != std::string::npos);
+    REQUIRE(results.at(3) == nlohmann::json{{"success", true}});
+    REQUIRE(addedPlaceIds == std::vector<std::string>{"A", "B"});
+
+    res = client.Post("/trigger_manual_transitions", R"(["T1", "NOPE", "T1"])", "application/json");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    results = nlohmann::json::parse(res->body);
+    REQUIRE(results.size() == 3U);
+    REQUIRE(results.at(0) == nlohmann::json{{"success", true}});
+    REQUIRE(results.at(1).at("success") == false);
+    REQUIRE(results.at(2) == nlohmann::json{{"success", true}});
+
+    server.stop();
+}
+
+TEST_CASE("Tokens for a full place are rejected with 429.", "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_backpressure");
+    std::vector<std::string> addedPlaceIds;
+    bnet::HttpServer server({{"unix_socket_path", socketPath}}, createControllerCallbacks(addedPlaceIds));
+    server.start();
+    auto client = createUnixClient(socketPath);
+
+    auto res = client.Post("/add_token", R"({"place_id": "FULL", "content_blocks": {}})", "application/json");
+    REQUIRE(res);
+    REQUIRE(res->status == 429);
+    REQUIRE(res->get_header_value("Retry-After") == "1");
+
+    res = client.Post("/add_token", R"({"place_id": "A", "content_blocks": {}})", "application/json");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    REQUIRE(addedPlaceIds == std::vector<std::string>{"A"});
+
+    server.stop();
+}
+
+TEST_CASE("The config is served with an ETag and revalidated with If-None-Match.", "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_etag");
+    std::vector<std::string> addedPlaceIds;
+    bnet::HttpServer server({{"unix_socket_path", socketPath}, {"gzip_min_size", 0U}},
+                            createControllerCallbacks(addedPlaceIds));
+    server.start();
+    auto client = createUnixClient(socketPath);
+    client.set_decompress(false); // check the body as sent
+
+    auto getConfig = [&client](httplib::Headers const& headers) {
+        auto res = client.Get("/get_config", headers);
+        REQUIRE(res);
+        REQUIRE(res->get_header_value("Vary") == "Accept-Encoding");
+        return res;
+    };
+
+    // strong ETag
+    auto res = getConfig({});
+    REQUIRE(res->status == 200);
+    REQUIRE(nlohmann::json::parse(res->body) == nlohmann::json{{"petri_net", nlohmann::json::object()}});
+    const auto etag = res->get_header_value("ETag");
+    REQUIRE(etag.size() > 2U);
+    REQUIRE(etag.front() == '"');
+    REQUIRE(etag.back() == '"');
+    REQUIRE(getConfig({})->get_header_value("ETag") == etag);
+
+    // the gzip variant has an ETag of its own
+    res = getConfig({{"Accept-Encoding", "gzip"}});
+    REQUIRE(res->status == 200);
+    REQUIRE(res->get_header_value("Content-Encoding") == "gzip");
+    const auto gzipEtag = res->get_header_value("ETag");
+    REQUIRE(gzipEtag.front() == '"');
+    REQUIRE(gzipEtag != etag);
+
+    auto requireNotModified = [&getConfig](httplib::Headers const& headers, std::string const& expectedEtag) {
+        auto notModified = getConfig(headers);
+        REQUIRE(notModified->status == 304);
+        REQUIRE(notModified->body.empty());
+        REQUIRE(notModified->get_header_value("ETag") == expectedEtag);
+    };
+    requireNotModified({{"If-None-Match", etag}}, etag);
+    requireNotModified({{"If-None-Match", "W/" + etag}}, etag); // weak comparison
+    requireNotModified({{"If-None-Match", "\"other\", " + etag}}, etag);
+    requireNotModified({{"If-None-Match", "*"}}, etag);
+    requireNotModified({{"If-None-Match", gzipEtag}, {"Accept-Encoding", "gzip"}}, gzipEtag);
+
+    // an ETag only matches its own variant
+    res = getConfig({{"If-None-Match", etag}, {"Accept-Encoding", "gzip"}});
+    REQUIRE(res->status == 200);
+    REQUIRE(res->get_header_value("ETag") == gzipEtag);
+    res = getConfig({{"If-None-Match", gzipEtag}});
+    REQUIRE(res->status == 200);
+    REQUIRE(res->get_header_value("ETag") == etag);
+    res = getConfig({{"If-None-Match", "\"other\", W/\"another\""}});
+    REQUIRE(res->status == 200);
+    REQUIRE_FALSE(res->body.empty());
+
+    server.stop();
+}
+
+TEST_CASE("The marking can be requested since a version, which must be a number.", "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_since");
+    std::vector<std::string> addedPlaceIds;
+    std::vector<std::optional<uint64_t>> requestedVersions;
+    auto callbacks = createControllerCallbacks(addedPlaceIds);
+    callbacks.getNetMarking = [&requestedVersions](std::optional<uint64_t> sinceVersion) {
+        requestedVersions.push_back(sinceVersion);
+        return nlohmann::json{{"version", 7}, {"marking", nlohmann::json::object()}};
+    };
+    bnet::HttpServer server({{"unix_socket_path", socketPath}}, callbacks);
+    server.start();
+    auto client = createUnixClient(socketPath);
+
+    auto res = client.Get("/get_marking");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    REQUIRE(res->get_header_value("X-Marking-Version") == "7");
+
+    res = client.Get("/get_marking?since=5");
+    REQUIRE(res);
+    REQUIRE(res->status == 200);
+    REQUIRE(requestedVersions == std::vector<std::optional<uint64_t>>{std::nullopt, 5U});
+
+    for (auto&& since : {"", "abc", "-1", "+5", "5x", "99999999999999999999"})
+    {
+        res = client.Get(std::string("/get_marking?since=") + since);
+        REQUIRE(res);
+        REQUIRE(res->status == 400);
+    }
+    REQUIRE(requestedVersions.size() == 2U);
+
+    server.stop();
+}
+
+TEST_CASE("Json responses are gzip compressed only if accepted and large enough.", "[BehaviorController/HttpServer]")
+{
+    const auto markingSize = getTestMarking().dump().size();
+    std::vector<std::string> addedPlaceIds;
+
+    auto getMarking = [](std::string const& socketPath, httplib::Headers const& headers) {
+        auto client = createUnixClient(socketPath);
+        client.set_decompress(false); // check the body as sent
+        auto res = client.Get("/get_marking", headers);
+        REQUIRE(res);
+        REQUIRE(res->status == 200);
+        REQUIRE(res->get_header_value("X-Marking-Version") == "1");
+        return res;
+    };
+
+    SECTION("at the threshold")
+    {
+        const auto socketPath = createSocketPath("bnet_http_gzip");
+        bnet::HttpServer server({{"unix_socket_path", socketPath}, {"gzip_min_size", markingSize}},
+                                createControllerCallbacks(addedPlaceIds));
+        server.start();
+
+        // the response may be compressed for other clients, so caches must key on the encoding
+        auto res = getMarking(socketPath, {});
+        REQUIRE_FALSE(res->has_header("Content-Encoding"));
+        REQUIRE(res->get_header_value("Vary") == "Accept-Encoding");
+        REQUIRE(nlohmann::json::parse(res->body) == getTestMarking());
+
+        res = getMarking(socketPath, {{"Accept-Encoding", "deflate, gzip;q=0.5"}});
+        REQUIRE(res->get_header_value("Content-Encoding") == "gzip");
+        REQUIRE(res->get_header_value("Vary") == "Accept-Encoding");
+        REQUIRE(res->body.size() < markingSize);
+        REQUIRE(nlohmann::json::parse(gzip::decompress(res->body)) == getTestMarking());
+
+        res = getMarking(socketPath, {{"Accept-Encoding", "gzip;q=0"}});
+        REQUIRE_FALSE(res->has_header("Content-Encoding"));
+        REQUIRE(nlohmann::json::parse(res->body) == getTestMarking());
+
+        server.stop();
+    }
+
+    SECTION("below the threshold")
+    {
+        const auto socketPath = createSocketPath("bnet_http_gzip_small");
+        bnet::HttpServer server({{"unix_socket_path", socketPath}, {"gzip_min_size", markingSize + 1U}},
+                                createControllerCallbacks(addedPlaceIds));
+        server.start();
+
+        auto res = getMarking(socketPath, {{"Accept-Encoding", "gzip"}});
+        REQUIRE_FALSE(res->has_header("Content-Encoding"));
+        REQUIRE_FALSE(res->has_header("Vary"));
+        REQUIRE(nlohmann::json::parse(res->body) == getTestMarking());
+
+        server.stop();
+    }
+}
+
+TEST_CASE("The marking stream sends the marking, then its changes, and resumes after the last event seen.",
+          "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_stream");
+    const auto config = createStreamNetConfig(socketPath, 4U);
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    controller.runDetached();
+    auto client = createUnixClient(socketPath);
+    waitForServer(client);
+
+    const auto events = readMarkingStream(client, {}, 2U, [&](StreamEvent const& event) {
+        if (event.data.at("full").get<bool>())
+        {
+            controller.addToken(nlohmann::json::object(), "A");
+        }
+    });
+    REQUIRE(events.size() == 2U);
+    REQUIRE(events.at(0).data.at("full") == true);
+    REQUIRE(events.at(0).data.at("marking") == nlohmann::json{{"A", 0}, {"B", 0}});
+    REQUIRE(events.at(1).data.at("full") == false);
+    REQUIRE(events.at(1).data.at("marking") == nlohmann::json{{"A", 1}});
+    REQUIRE(events.at(1).id > events.at(0).id);
+
+    // the changes missed since the first event
+    auto resumed = readMarkingStream(client, {{"Last-Event-ID", std::to_string(events.at(0).id)}}, 1U);
+    REQUIRE(resumed.size() == 1U);
+    REQUIRE(resumed.at(0).id == events.at(1).id);
+    REQUIRE(resumed.at(0).data.at("full") == false);
+    REQUIRE(resumed.at(0).data.at("marking") == nlohmann::json{{"A", 1}});
+
+    // e.g., an event id of a previous run of the controller
+    resumed = readMarkingStream(client, {{"Last-Event-ID", std::to_string(events.at(1).id + 100U)}}, 1U);
+    REQUIRE(resumed.size() == 1U);
+    REQUIRE(resumed.at(0).data.at("full") == true);
+    REQUIRE(resumed.at(0).data.at("marking") == nlohmann::json{{"A", 1}, {"B", 0}});
+
+    auto res = client.Get("/marking_stream", {{"Last-Event-ID", "abc"}});
+    REQUIRE(res);
+    REQUIRE(res->status == 400);
+
+    controller.stop();
+}
+
+TEST_CASE("Marking streams past \"max_streams\" are rejected with 503.", "[BehaviorController/HttpServer]")
+{
+    const auto socketPath = createSocketPath("bnet_http_max_streams");
+    const auto config = createStreamNetConfig(socketPath, 1U);
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    controller.runDetached();
+    auto client = createUnixClient(socketPath);
+    waitForServer(client);
+
+    std::atomic_bool isStreaming{false};
+    std::atomic_bool isReleased{false};
+    std::thread streamer([&] {
+        auto streamClient = createUnixClient(socketPath);
+        readMarkingStream(streamClient, {}, 1U, [&](StreamEvent const&) {
+            isStreaming.store(true);
+            while (!isReleased.load())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    });
+    while (!isStreaming.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto res = client.Get("/marking_stream");
+    REQUIRE(res);
+    REQUIRE(res->status == 503);
+    REQUIRE(res->get_header_value("Retry-After") == "1");
+    REQUIRE(client.Get("/")->status == 200); // other endpoints are still served
+
+    // the slot is freed once the server notices the closed stream, at the latest on its next heartbeat
+    isReleased.store(true);
+    streamer.join();
+    std::vector<StreamEvent> events;
+    for (int i = 0; i < 50 && events.empty(); ++i)
+    {
+        events = readMarkingStream(client, {}, 1U);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    REQUIRE(events.size() == 1U);
+
+    controller.stop();
+}
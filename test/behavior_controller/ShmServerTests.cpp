@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/server_impl/ShmProducer.hpp>
+#include <behavior_net/server_impl/ShmServer.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace capybot;
+
+namespace
+{
+/// @brief requests received by the controller, one entry per batch; called from the drain thread
+struct ReceivedBatches
+{
+    std::mutex mtx;
+    std::vector<std::vector<std::string>> tokenPlaceIds;
+    std::vector<std::vector<std::string>> transitionIds;
+    std::size_t requestCount{0U};
+};
+
+bnet::ControllerCallbacks createControllerCallbacks(ReceivedBatches& received)
+{
+    static const nlohmann::json config{{"petri_net", nlohmann::json::object()}};
+    return bnet::ControllerCallbacks{
+        .addToken = [](nlohmann::json, std::string_view, auto) {},
+        .addTokens =
+            [&received](std::vector<bnet::TokenRequest> requests) {
+                std::lock_guard<std::mutex> lk(received.mtx);
+                auto& batch = received.tokenPlaceIds.emplace_back();
+                for (auto&& request : requests)
+                {
+                    batch.push_back(request.placeId);
+                }
+                received.requestCount += requests.size();
+                return bnet::BulkResults(requests.size());
+            },
+        .getNetMarking = [](auto) { return nlohmann::json::object(); },
+        .getNetConfig = []() -> nlohmann::json const& { return config; },
+        .triggerManualTransition = [](auto) {},
+        .triggerManualTransitions =
+            [&received](std::vector<std::string> const& ids) {
+                std::lock_guard<std::mutex> lk(received.mtx);
+                received.transitionIds.push_back(ids);
+                received.requestCount += ids.size();
+                return bnet::BulkResults(ids.size());
+            },
+        .getMarkingUpdates = [](auto, auto) { return nlohmann::json::object(); }};
+}
+} // namespace
+
+TEST_CASE("Requests pushed through ShmProducer reach the controller in batches.", "[BehaviorController/ShmServer]")
+{
+    const auto name = "/bnet_shm_server_test_" + std::to_string(::getpid());
+    ReceivedBatches received;
+    // a long drain period, so that all requests below are drained at once
+    bnet::ShmServer server({{"name", name}, {"slot_count", 16}, {"slot_size", 256}, {"drain_period_us", 200000}},
+                           createControllerCallbacks(received));
+    REQUIRE_THROWS_AS(bnet::ShmProducer(name), std::runtime_error); // created on start
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // past the first, empty, drain
+
+    bnet::ShmProducer producer(name);
+    auto ring = ShmRing::open(name); // for requests ShmProducer cannot encode
+    REQUIRE(producer.addToken(nlohmann::json::object(), "A"));
+    REQUIRE(producer.addToken(nlohmann::json::object(), "B", std::chrono::milliseconds(100)));
+    REQUIRE(ring->tryPush(bnet::ShmMessageType::ADD_TOKEN, "\xff\xff")); // not CBOR
+    REQUIRE(ring->tryPush(bnet::ShmMessageType::ADD_TOKEN, "\xa0")); // {}, not a token request
+    REQUIRE(ring->tryPush(99U, "\xa0"));
+    REQUIRE(producer.triggerManualTransition("T1"));
+    REQUIRE(producer.triggerManualTransition("T2"));
+    REQUIRE(producer.addToken(nlohmann::json::object(), "C"));
+
+    for (int i = 0; i < 200; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lk(received.mtx);
+        if (received.requestCount == 5U)
+        {
+            break;
+        }
+    }
+    {
+        // the invalid requests are dropped without splitting the token batch
+        std::lock_guard<std::mutex> lk(received.mtx);
+        REQUIRE(received.tokenPlaceIds == std::vector<std::vector<std::string>>{{"A", "B"}, {"C"}});
+        REQUIRE(received.transitionIds == std::vector<std::vector<std::string>>{{"T1", "T2"}});
+    }
+
+    server.stop();
+    REQUIRE_THROWS_AS(bnet::ShmProducer(name), std::runtime_error); // removed on stop
+}
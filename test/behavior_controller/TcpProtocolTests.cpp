@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/server_impl/TcpProtocol.hpp>
+
+using namespace capybot;
+
+TEST_CASE("TCP frames are parsed once complete", "[BehaviorController/TcpProtocol]")
+{
+    std::string buffer;
+    bnet::TcpFrame::append(buffer, bnet::TcpMessageType::ADD_TOKEN, 7U, "abc");
+    bnet::TcpFrame::append(buffer, bnet::TcpMessageType::GET_MARKING, 0x01020304U, "");
+    REQUIRE(buffer.size() == 2U * bnet::TcpFrame::HEADER_SIZE + 3U);
+
+    std::size_t frameSize{0U};
+    REQUIRE_FALSE(bnet::TcpFrame::parse(std::string_view(buffer).substr(0, 4), frameSize, 1024U).has_value());
+    REQUIRE_FALSE(bnet::TcpFrame::parse(std::string_view(buffer).substr(0, 11), frameSize, 1024U).has_value());
+
+    // pipelined frames are read one after the other
+    auto frame = bnet::TcpFrame::parse(buffer, frameSize, 1024U);
+    REQUIRE(frame.has_value());
+    REQUIRE(frameSize == bnet::TcpFrame::HEADER_SIZE + 3U);
+    REQUIRE(frame->type == bnet::TcpMessageType::ADD_TOKEN);
+    REQUIRE(frame->requestId == 7U);
+    REQUIRE(frame->body == "abc");
+
+    frame = bnet::TcpFrame::parse(std::string_view(buffer).substr(frameSize), frameSize, 1024U);
+    REQUIRE(frame.has_value());
+    REQUIRE(frame->type == bnet::TcpMessageType::GET_MARKING);
+    REQUIRE(frame->requestId == 0x01020304U);
+    REQUIRE(frame->body.empty());
+
+    // body size is checked before the body is received
+    REQUIRE_THROWS_AS(bnet::TcpFrame::parse(std::string_view(buffer).substr(0, 9), frameSize, 2U), bnet::Exception);
+}
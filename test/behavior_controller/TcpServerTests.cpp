@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <catch2/catch_test_macros.hpp>
+
+#include <behavior_net/server_impl/TcpServer.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace capybot;
+
+namespace
+{
+/// @return a port that was free when the function returned
+int findFreePort()
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen{sizeof(addr)};
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), addrLen);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+int connectTo(int port)
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    timeval timeout{.tv_sec = 5, .tv_usec = 0}; // tests fail instead of hanging
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+std::string toCbor(nlohmann::json const& json)
+{
+    const auto bytes = nlohmann::json::to_cbor(json);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+/// @brief read up to `count` frames; fewer if the server closes the connection
+std::vector<bnet::TcpFrame> readFrames(int fd, std::size_t count)
+{
+    std::vector<bnet::TcpFrame> frames;
+    std::string in;
+    char buffer[4096];
+    while (frames.size() < count)
+    {
+        std::size_t frameSize{0U};
+        if (auto frame = bnet::TcpFrame::parse(in, frameSize, 1024U * 1024U))
+        {
+            frames.push_back(std::move(frame.value()));
+            in.erase(0, frameSize);
+            continue;
+        }
+        const auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        in.append(buffer, static_cast<std::size_t>(n));
+    }
+    return frames;
+}
+
+/// @return whether the server closed the connection
+bool isClosed(int fd)
+{
+    char byte;
+    return ::recv(fd, &byte, 1, 0) == 0;
+}
+
+/// @brief callbacks of a controller in which place "FULL" takes no tokens; records the size of each addTokens batch
+bnet::ControllerCallbacks createControllerCallbacks(std::vector<std::size_t>& batchSizes)
+{
+    static const nlohmann::json config{{"petri_net", nlohmann::json::object()}};
+    return bnet::ControllerCallbacks{
+        .addToken = [](nlohmann::json, std::string_view, auto) {},
+        .addTokens =
+            [&batchSizes](std::vector<bnet::TokenRequest> requests) {
+                batchSizes.push_back(requests.size());
+                bnet::BulkResults results;
+                for (auto&& request : requests)
+                {
+                    results.push_back(request.placeId == "FULL" ? std::optional<std::string>("place is full.")
+                                                                : std::nullopt);
+                }
+                return results;
+            },
+        .getNetMarking = [](auto) { return nlohmann::json{{"version", 3}, {"marking", {{"A", 1}}}}; },
+        .getNetConfig = []() -> nlohmann::json const& { return config; },
+        .triggerManualTransition = [](auto) {},
+        .triggerManualTransitions = [](auto const&) { return bnet::BulkResults{}; },
+        .getMarkingUpdates = [](auto, auto) { return nlohmann::json::object(); }};
+}
+} // namespace
+
+TEST_CASE("Pipelined requests are answered in order, and consecutive tokens are added together.",
+          "[BehaviorController/TcpServer]")
+{
+    const int port = findFreePort();
+    std::vector<std::size_t> batchSizes;
+    bnet::TcpServer server({{"address", "127.0.0.1"}, {"port", port}}, createControllerCallbacks(batchSizes));
+    server.start();
+    const int fd = connectTo(port);
+
+    const auto token = [](std::string const& placeId) {
+        return toCbor({{"place_id", placeId}, {"content_blocks", nlohmann::json::object()}});
+    };
+    std::string requests;
+    bnet::TcpFrame::append(requests, bnet::TcpMessageType::ADD_TOKEN, 11U, token("A"));
+    bnet::TcpFrame::append(requests, bnet::TcpMessageType::ADD_TOKEN, 12U, toCbor({{"place_id", "A"}}));
+    bnet::TcpFrame::append(requests, bnet::TcpMessageType::ADD_TOKEN, 13U, token("FULL"));
+    bnet::TcpFrame::append(requests, bnet::TcpMessageType::GET_MARKING, 14U, "");
+    bnet::TcpFrame::append(requests, bnet::TcpMessageType::ADD_TOKEN, 15U, token("B"));
+    REQUIRE(::send(fd, requests.data(), requests.size(), 0) == static_cast<ssize_t>(requests.size()));
+
+    const auto responses = readFrames(fd, 5U);
+    REQUIRE(responses.size() == 5U);
+    for (uint32_t i = 0; i < 5U; ++i)
+    {
+        REQUIRE(responses.at(i).requestId == 11U + i);
+    }
+    REQUIRE(responses.at(0).type == bnet::TcpMessageType::RESPONSE_OK);
+    REQUIRE(responses.at(1).type == bnet::TcpMessageType::RESPONSE_ERROR);
+    REQUIRE(nlohmann::json::from_cbor(responses.at(1).body).at("error").get<std::string>().starts_with("invalid"));
+    REQUIRE(responses.at(2).type == bnet::TcpMessageType::RESPONSE_ERROR);
+    REQUIRE(responses.at(3).type == bnet::TcpMessageType::RESPONSE_OK);
+    REQUIRE(nlohmann::json::from_cbor(responses.at(3).body).at("version") == 3);
+    REQUIRE(responses.at(4).type == bnet::TcpMessageType::RESPONSE_OK);
+
+    // the malformed token is rejected by the server; GET_MARKING splits the tokens in two batches
+    REQUIRE(batchSizes == std::vector<std::size_t>{2U, 1U});
+
+    ::close(fd);
+    server.stop();
+}
+
+TEST_CASE("Connections sending oversized frames are closed.", "[BehaviorController/TcpServer]")
+{
+    const int port = findFreePort();
+    std::vector<std::size_t> batchSizes;
+    bnet::TcpServer server({{"address", "127.0.0.1"}, {"port", port}, {"max_frame_size", 16}},
+                           createControllerCallbacks(batchSizes));
+    server.start();
+    const int fd = connectTo(port);
+
+    // only the header is sent: the body size is checked first
+    std::string frame;
+    bnet::TcpFrame::append(frame, bnet::TcpMessageType::ADD_TOKEN, 1U, std::string(17U, 'x'));
+    REQUIRE(::send(fd, frame.data(), bnet::TcpFrame::HEADER_SIZE, 0) == bnet::TcpFrame::HEADER_SIZE);
+    REQUIRE(isClosed(fd));
+    REQUIRE(batchSizes.empty());
+
+    ::close(fd);
+    server.stop();
+}
+
+TEST_CASE("Connections past \"max_connections\" are closed, and finished ones free their slot.",
+          "[BehaviorController/TcpServer]")
+{
+    const int port = findFreePort();
+    std::vector<std::size_t> batchSizes;
+    bnet::TcpServer server({{"address", "127.0.0.1"}, {"port", port}, {"max_connections", 1}},
+                           createControllerCallbacks(batchSizes));
+    server.start();
+
+    std::string request;
+    bnet::TcpFrame::append(request, bnet::TcpMessageType::GET_MARKING, 1U, "");
+    const auto isServed = [&request](int fd) {
+        ::send(fd, request.data(), request.size(), 0);
+        return readFrames(fd, 1U).size() == 1U;
+    };
+
+    const int first = connectTo(port);
+    REQUIRE(isServed(first));
+    const int second = connectTo(port);
+    REQUIRE_FALSE(isServed(second));
+    ::close(second);
+
+    ::close(first);
+    bool isThirdServed{false};
+    for (int i = 0; i < 50 && !isThirdServed; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const int third = connectTo(port);
+        isThirdServed = isServed(third);
+        ::close(third);
+    }
+    REQUIRE(isThirdServed);
+
+    server.stop();
+}
+
+TEST_CASE("Stopping the server closes open connections.", "[BehaviorController/TcpServer]")
+{
+    const int port = findFreePort();
+    std::vector<std::size_t> batchSizes;
+    bnet::TcpServer server({{"address", "127.0.0.1"}, {"port", port}}, createControllerCallbacks(batchSizes));
+    server.start();
+
+    std::vector<int> fds{connectTo(port), connectTo(port)};
+    std::string request;
+    bnet::TcpFrame::append(request, bnet::TcpMessageType::GET_MARKING, 1U, "");
+    for (auto&& fd : fds)
+    {
+        ::send(fd, request.data(), request.size(), 0);
+        REQUIRE(readFrames(fd, 1U).size() == 1U); // accepted and idle
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    server.stop();
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    for (auto&& fd : fds)
+    {
+        REQUIRE(isClosed(fd));
+        ::close(fd);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <behavior_net/ActionRegistry.hpp>
+
+namespace
+{
+
+/// @brief resolves tokens to the configured "result" right away
+class PluginTestAction : public capybot::bnet::IActionImpl
+{
+public:
+    PluginTestAction(nlohmann::json const config)
+        : m_result(capybot::bnet::ActionExecutionStatus::_from_string(config.at("result").get<std::string>().c_str()))
+    {
+    }
+
+    std::function<capybot::bnet::ActionExecutionStatus()> createCallable(
+        capybot::bnet::Token::ConstSharedPtr token) override
+    {
+        return [this]() { return m_result; };
+    }
+
+private:
+    const capybot::bnet::ActionExecutionStatus m_result;
+};
+
+} // namespace
+
+REGISTER_ACTION_PLUGIN(PluginTestAction);
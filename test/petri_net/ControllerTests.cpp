@@ -22,11 +22,37 @@
 #include "TestsCommon.hpp"
 
 #include <chrono>
+#include <map>
+#include <mutex>
 #include <string>
 #include <thread>
 
 using namespace capybot;
 
+namespace
+{
+
+/// @brief never completes; counts how many times each token was executed
+class PollCountingAction : public bnet::IActionImpl
+{
+public:
+    PollCountingAction(nlohmann::json const) {}
+
+    std::function<bnet::ActionExecutionStatus()> createCallable(bnet::Token::ConstSharedPtr token) override
+    {
+        return [token]() {
+            std::lock_guard<std::mutex> lk(executionsMtx);
+            ++executions[token.get()];
+            return bnet::ActionExecutionStatus::IN_PROGRESS;
+        };
+    }
+
+    static inline std::map<bnet::Token const*, int> executions;
+    static inline std::mutex executionsMtx;
+};
+
+} // namespace
+
 TEST_CASE("The controller properly initialized from config files, and we can trigger a transition.",
           "[BehaviorController/Controller]")
 {
@@ -46,4 +72,112 @@ TEST_CASE("The controller properly initialized from config files, and we can tri
     std::this_thread::sleep_for(std::chrono::seconds(3));
 
     controller.stop();
-}
\ No newline at end of file
+}
+
+TEST_CASE("Action places are executed on their own poll period.", "[BehaviorController/Controller]")
+{
+    bnet::ActionRegistry::registerActionType(
+        [](nlohmann::json const parameters) { return std::make_unique<PollCountingAction>(parameters); },
+        "PollCountingAction");
+    auto config = bnet::NetConfig("test/petri_net/config/place_poll_period.json");
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    auto& places = controller.getNet().getPlaces();
+    controller.addToken(nlohmann::json::object(), "FAST");
+    controller.addToken(nlohmann::json::object(), "SLOW");
+    auto const* fastToken = places.at("FAST")->getTokensBusy().front().get();
+    auto const* slowToken = places.at("SLOW")->getTokensBusy().front().get();
+
+    controller.runDetached();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    controller.stop();
+
+    // FAST follows the 20 ms epoch; SLOW is polled every 200 ms, i.e., at 0, 200, and 400 ms
+    std::lock_guard<std::mutex> lk(PollCountingAction::executionsMtx);
+    REQUIRE(PollCountingAction::executions[fastToken] >= 10);
+    REQUIRE(PollCountingAction::executions[slowToken] >= 2);
+    REQUIRE(PollCountingAction::executions[slowToken] <= 4);
+}
+
+TEST_CASE("Results of fast polled places are fired on without waiting for the epoch.",
+          "[BehaviorController/Controller]")
+{
+    // FAST is polled every 10 ms, the epoch is 10 s
+    auto config = bnet::NetConfig("test/petri_net/config/fast_place_long_epoch.json");
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    auto& places = controller.getNet().getPlaces();
+
+    controller.runDetached();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // past the first epoch
+    controller.addToken(nlohmann::json::object(), "FAST");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    controller.stop();
+
+    REQUIRE(places.at("FAST")->getNumberTokensTotal() == 0);
+    REQUIRE(places.at("DONE")->getNumberTokensTotal() == 1);
+}
+
+TEST_CASE("High priority transitions fire before normal ones in the same epoch.", "[BehaviorController/Controller]")
+{
+    // T_NORMAL (A -> C) comes first in the config, but T_HIGH (A -> B) gets the only token
+    auto config = bnet::NetConfig("test/petri_net/config/transition_priority_race.json");
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    auto& places = controller.getNet().getPlaces();
+    controller.addToken(nlohmann::json::object(), "A");
+
+    controller.runEpoch(); // the first epoch is due right away
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 0);
+    REQUIRE(places.at("B")->getNumberTokensTotal() == 1);
+    REQUIRE(places.at("C")->getNumberTokensTotal() == 0);
+}
+
+TEST_CASE("Bulk requests report a result for each item in order.", "[BehaviorController/Controller]")
+{
+    auto config = bnet::NetConfig("test/petri_net/config/bulk_requests.json");
+    bnet::Controller controller(config, bnet::PetriNet::create(config));
+    auto& places = controller.getNet().getPlaces();
+
+    auto request = [](std::string placeId) {
+        return bnet::TokenRequest{nlohmann::json::object(), std::move(placeId), std::nullopt};
+    };
+    // B only takes two tokens, the third one is rejected without affecting the others
+    auto tokenResults = controller.addTokens({request("A"), request("NOPE"), request("B"), request("B"), request("B")});
+    REQUIRE(tokenResults.size() == 5);
+    REQUIRE_FALSE(tokenResults[0].has_value());
+    REQUIRE(tokenResults[1].has_value());
+    REQUIRE_FALSE(tokenResults[2].has_value());
+    REQUIRE_FALSE(tokenResults[3].has_value());
+    REQUIRE(tokenResults[4].has_value());
+    REQUIRE(tokenResults[4]->find("full") != std::string::npos);
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 1);
+    REQUIRE(places.at("B")->getNumberTokensTotal() == 2);
+
+    // the second T1 finds A empty
+    auto transitionResults = controller.triggerManualTransitions({"T1", "NOPE", "T1"});
+    REQUIRE(transitionResults.size() == 3);
+    REQUIRE_FALSE(transitionResults[0].has_value());
+    REQUIRE(transitionResults[1].has_value());
+    REQUIRE(transitionResults[2].has_value());
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 0);
+    REQUIRE(places.at("C")->getNumberTokensTotal() == 1);
+}
+
+TEST_CASE("Token requests are parsed in a single pass.", "[BehaviorController/Controller]")
+{
+    const std::string payload =
+        R"({"unknown": {"place_id": 1, "list": [{}]}, "content_blocks": {"robot": {"waypoints": [[1.5, 2], [3, -4]],
+            "name": "r1", "ok": true, "none": null}, "empty": {}}, "ttl_ms": 500, "place_id": "A"})";
+    auto request = bnet::TokenRequest::parse(payload);
+    REQUIRE(request.placeId == "A");
+    REQUIRE(request.ttl == std::chrono::milliseconds(500));
+    REQUIRE(request.contentBlocks == nlohmann::json::parse(payload).at("content_blocks"));
+    REQUIRE_FALSE(bnet::TokenRequest::parse(R"({"place_id": "A", "content_blocks": {}})").ttl.has_value());
+
+    for (auto&& invalid :
+         {R"([])", R"("A")", R"({"place_id": "A"})", R"({"content_blocks": {}})",
+          R"({"place_id": 1, "content_blocks": {}})", R"({"place_id": "A", "content_blocks": []})",
+          R"({"place_id": "A", "content_blocks": {}, "ttl_ms": -1})", R"({"place_id": "A", "content_blocks": {})",
+          R"({"place_id": "A", "content_blocks": {}} {})"})
+    {
+        REQUIRE_THROWS_AS(bnet::TokenRequest::parse(invalid), bnet::Exception);
+    }
+}
@@ -78,6 +78,10 @@ TEST_CASE("NeConfig validators work as expected.", "[PetriNet/NeConfig]")
     {
         REQUIRE_BNET_THROW_AS(NetConfig("test/petri_net/config/place_duplicated_ids.json"),
                               ExceptionType::INVALID_CONFIG_FILE);
+        REQUIRE_BNET_THROW_AS(NetConfig("test/petri_net/config/place_invalid_capacity.json"),
+                              ExceptionType::INVALID_CONFIG_FILE);
+        REQUIRE_BNET_THROW_AS(NetConfig("test/petri_net/config/place_invalid_expiry_place.json"),
+                              ExceptionType::INVALID_CONFIG_FILE);
     }
 
     // Transition
@@ -89,5 +93,117 @@ TEST_CASE("NeConfig validators work as expected.", "[PetriNet/NeConfig]")
                               ExceptionType::INVALID_CONFIG_FILE);
         REQUIRE_BNET_THROW_AS(NetConfig("test/petri_net/config/transition_duplicated_ids.json"),
                               ExceptionType::INVALID_CONFIG_FILE);
+        REQUIRE_BNET_THROW_AS(NetConfig("test/petri_net/config/transition_invalid_priority.json"),
+                              ExceptionType::INVALID_CONFIG_FILE);
+    }
+}
+
+TEST_CASE("Full places disable their input transitions and reject new tokens.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/place_capacity.json"));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        auto token = Token::makeUnique();
+        net->addToken(token, "A");
+    }
+
+    auto& transition = net->getTransitions().front();
+    REQUIRE(transition.isEnabled());
+    net->triggerTransition("T1");
+
+    // B is full: the transition is disabled even though A has tokens
+    REQUIRE(transition.hasInputTokens());
+    REQUIRE_FALSE(transition.isEnabled());
+    REQUIRE_BNET_THROW_AS(net->triggerTransition("T1"), ExceptionType::CAPACITY_EXCEEDED);
+
+    auto token = Token::makeUnique();
+    REQUIRE_BNET_THROW_AS(net->addToken(token, "B"), ExceptionType::CAPACITY_EXCEEDED);
+
+    // consuming from B frees capacity
+    net->getPlaces().at("B")->consumeToken();
+    REQUIRE(transition.isEnabled());
+}
+
+TEST_CASE("Unconsumed tokens expire after their TTL.", "[PetriNet]")
+{
+    using namespace std::chrono_literals;
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/place_token_ttl.json"));
+    auto& places = net->getPlaces();
+    const auto start = Token::Clock::now();
+
+    // place TTL (1s) applies to tokens in A; tokens carrying an earlier deadline expire first
+    for (int i = 0; i < 3; ++i)
+    {
+        auto token = Token::makeUnique();
+        if (i == 0)
+        {
+            token->setExpiry(start + 100ms);
+        }
+        net->addToken(token, "A");
+    }
+    // token TTL applies in places without one
+    {
+        auto token = Token::makeUnique();
+        token->setExpiry(start + 100ms);
+        net->addToken(token, "B");
     }
+
+    REQUIRE(net->getNextExpiry() == start + 100ms);
+    net->expireTokens(start);
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 3);
+    REQUIRE(places.at("B")->getNumberTokensTotal() == 1);
+
+    net->expireTokens(start + 200ms);
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 2);
+    REQUIRE(places.at("B")->getNumberTokensTotal() == 0); // no expiry place: dropped
+    REQUIRE(places.at("EXPIRED")->getNumberTokensTotal() == 1);
+    REQUIRE(net->getNextExpiry() > start + 200ms); // the place TTL of the tokens left in A
+    REQUIRE(net->getNextExpiry() <= Token::Clock::now() + 1s);
+
+    // consumed tokens are no longer tracked
+    std::ignore = places.at("A")->consumeToken();
+
+    // EXPIRED is full: the remaining token is dropped
+    net->expireTokens(start + 2s);
+    REQUIRE(places.at("A")->getNumberTokensTotal() == 0);
+    REQUIRE(places.at("EXPIRED")->getNumberTokensTotal() == 1);
+    REQUIRE(net->getNextExpiry() == Token::Clock::time_point::max());
+
+    // expired tokens do not expire again in the expiry place
+    net->expireTokens(start + 1h);
+    REQUIRE(places.at("EXPIRED")->getNumberTokensTotal() == 1);
+}
+
+TEST_CASE("Transitions are assigned to the configured priority lane.", "[PetriNet]")
+{
+    auto net = PetriNet::create(NetConfig("test/petri_net/config/transition_priority.json"));
+    auto& transitions = net->getTransitions();
+    REQUIRE(transitions.size() == 2);
+    REQUIRE(transitions.at(0).getPriority() == +TransitionPriority::HIGH);
+    REQUIRE(transitions.at(1).getPriority() == +TransitionPriority::NORMAL); // default
+}
+
+TEST_CASE("Marking queries can be limited to places changed since a version.", "[PetriNet]")
+{
+    auto net = createFromSampleConfig();
+    const auto initialVersion = net->getMarkingVersion();
+    REQUIRE(net->getMarking(initialVersion)["marking"].empty());
+
+    auto token = Token::makeUnique();
+    net->addToken(token, "A");
+    auto m = net->getMarking(initialVersion);
+    REQUIRE(m["version"] == initialVersion + 1U);
+    REQUIRE(m["marking"] == nlohmann::json{{"A", 1}});
+
+    const auto version = m["version"].get<uint64_t>();
+    net->triggerTransition("T1");
+    m = net->getMarking(version);
+    REQUIRE(m["version"] > version);
+    REQUIRE(m["marking"] == nlohmann::json{{"A", 0}, {"B", 1}, {"C", 1}});
+
+    // whole marking, with no config copy
+    m = net->getMarking();
+    REQUIRE(m["marking"].size() == net->getPlaces().size());
+    REQUIRE_FALSE(m.contains("config"));
 }
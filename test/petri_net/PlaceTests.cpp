@@ -97,3 +97,38 @@ TEST_CASE("A place can have tokens, execute action on them, and get those consum
 
     REQUIRE_BNET_THROW_AS(place->consumeToken(), ExceptionType::LOGIC_ERROR); // no tokens to consume
 }
+
+TEST_CASE("Busy tokens expire at their deadline and their action execution is cancelled", "[PetriNet/Place]")
+{
+    auto config = nlohmann::json::parse(R"({
+        "places": [{"place_id": "A"}],
+        "actions": [{"place_id": "A", "type": "TimerAction", "params": {"duration_ms": 100}}]
+    })");
+    auto places = Place::Factory::createPlaces(config);
+    ThreadPool tp;
+    Place::Factory::createActions(tp, config["actions"], places);
+    auto place = places.at("A");
+
+    const auto start = Token::Clock::now();
+    auto expiring = Token::makeShared();
+    expiring->setExpiry(start + std::chrono::milliseconds(50));
+    place->insertToken(expiring);
+    place->insertToken(Token::makeShared());
+    place->executeActionAsync();
+
+    REQUIRE(place->popExpiredTokens(start).empty());
+    const auto expired = place->popExpiredTokens(start + std::chrono::milliseconds(60));
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired.front() == expiring);
+    REQUIRE(place->getNumberTokensBusy() == 1);
+
+    // the cancelled execution reports no result, which would not match any busy token
+    for (int i = 0; i < 2; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        place->checkActionResults();
+        place->executeActionAsync();
+    }
+    REQUIRE(place->getNumberTokensBusy() == 0);
+    REQUIRE(place->getNumberTokensAvailable() == 1);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/ChangeFeed.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Readers get the events published after the last one they have seen", "[CapybotUtils/ChangeFeed]")
+{
+    ChangeFeed<std::string> feed(3U);
+
+    auto changes = feed.waitForChanges(0U, 1ms); // timeout
+    REQUIRE(changes.events.empty());
+    REQUIRE(changes.lastSequence == 0U);
+    REQUIRE(changes.isComplete);
+
+    REQUIRE(feed.publish("a") == 1U);
+    REQUIRE(feed.publish("b") == 2U);
+    changes = feed.waitForChanges(0U, 1ms);
+    REQUIRE(changes.events == std::vector<std::string>{"a", "b"});
+    REQUIRE(changes.lastSequence == 2U);
+
+    changes = feed.waitForChanges(1U, 1ms);
+    REQUIRE(changes.events == std::vector<std::string>{"b"});
+    REQUIRE(feed.waitForChanges(2U, 1ms).events.empty());
+
+    // "a" and "b" are dropped from the history
+    feed.publish("c");
+    feed.publish("d");
+    feed.publish("e");
+    changes = feed.waitForChanges(0U, 1ms);
+    REQUIRE_FALSE(changes.isComplete);
+    REQUIRE(changes.events == std::vector<std::string>{"c", "d", "e"});
+    changes = feed.waitForChanges(2U, 1ms);
+    REQUIRE(changes.isComplete);
+    REQUIRE(changes.lastSequence == 5U);
+}
+
+TEST_CASE("Readers ahead of the feed are told to resync", "[CapybotUtils/ChangeFeed]")
+{
+    // e.g., a reader resuming after a restart of the publisher
+    ChangeFeed<std::string> feed(3U);
+    feed.publish("a");
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto changes = feed.waitForChanges(7U, 10s);
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+    REQUIRE_FALSE(changes.isComplete);
+    REQUIRE(changes.events.empty());
+    REQUIRE(changes.lastSequence == 1U);
+}
+
+TEST_CASE("Readers are woken up by new events", "[CapybotUtils/ChangeFeed]")
+{
+    ChangeFeed<int> feed(8U);
+
+    std::thread publisher([&feed] {
+        std::this_thread::sleep_for(10ms);
+        feed.publish(42);
+    });
+    const auto changes = feed.waitForChanges(0U, 10s);
+    publisher.join();
+
+    REQUIRE(changes.events == std::vector<int>{42});
+    REQUIRE(feed.getLastSequence() == 1U);
+}
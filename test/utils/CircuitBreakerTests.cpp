@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/CircuitBreaker.hpp>
+
+#include <chrono>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Circuit opens after consecutive failures and recovers through a half-open probe",
+          "[CapybotUtils/CircuitBreaker]")
+{
+    const auto t0 = CircuitBreaker::Clock::now();
+    CircuitBreaker breaker(3U, 100ms);
+
+    // failures are only counted if consecutive
+    REQUIRE(breaker.tryAcquire(t0));
+    breaker.recordFailure(t0);
+    breaker.recordFailure(t0);
+    breaker.recordSuccess();
+    breaker.recordFailure(t0);
+    breaker.recordFailure(t0);
+    REQUIRE(breaker.getState() == CircuitBreaker::State::CLOSED);
+
+    breaker.recordFailure(t0);
+    REQUIRE(breaker.getState() == CircuitBreaker::State::OPEN);
+    REQUIRE_FALSE(breaker.tryAcquire(t0 + 50ms));
+    REQUIRE(breaker.getRemainingOpenTime(t0 + 50ms) == 50ms);
+
+    // failed probe
+    REQUIRE(breaker.tryAcquire(t0 + 100ms));
+    REQUIRE(breaker.getState() == CircuitBreaker::State::HALF_OPEN);
+    REQUIRE_FALSE(breaker.tryAcquire(t0 + 100ms)); // a single probe at a time
+    breaker.recordFailure(t0 + 100ms);
+    REQUIRE(breaker.getState() == CircuitBreaker::State::OPEN);
+    REQUIRE_FALSE(breaker.tryAcquire(t0 + 150ms));
+
+    // successful probe
+    REQUIRE(breaker.tryAcquire(t0 + 200ms));
+    breaker.recordSuccess();
+    REQUIRE(breaker.getState() == CircuitBreaker::State::CLOSED);
+    REQUIRE(breaker.tryAcquire(t0 + 200ms));
+    REQUIRE(breaker.tryAcquire(t0 + 200ms));
+}
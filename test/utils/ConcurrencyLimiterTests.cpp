@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/ConcurrencyLimiter.hpp>
+
+using namespace capybot;
+
+TEST_CASE("Slots are limited per key", "[CapybotUtils/ConcurrencyLimiter]")
+{
+    ConcurrencyLimiter limiter;
+
+    REQUIRE(limiter.tryAcquire("robot_1", 2U));
+    REQUIRE(limiter.tryAcquire("robot_1", 2U));
+    REQUIRE_FALSE(limiter.tryAcquire("robot_1", 2U));
+    REQUIRE(limiter.tryAcquire("robot_2", 2U)); // independent keys
+    REQUIRE(limiter.getInUse("robot_1") == 2U);
+
+    limiter.release("robot_1");
+    REQUIRE(limiter.getInUse("robot_1") == 1U);
+    REQUIRE(limiter.tryAcquire("robot_1", 2U));
+    REQUIRE_FALSE(limiter.tryAcquire("robot_1", 2U));
+
+    REQUIRE_FALSE(limiter.tryAcquire("robot_3", 0U));
+    REQUIRE(limiter.getInUse("robot_3") == 0U);
+}
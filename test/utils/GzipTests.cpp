@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/Gzip.hpp>
+
+#include <string>
+
+using namespace capybot;
+
+TEST_CASE("Compressed data can be decompressed back", "[CapybotUtils/Gzip]")
+{
+    std::string data;
+    for (int i = 0; i < 10000; ++i)
+    {
+        data += "{\"place_id\": \"P" + std::to_string(i % 100) + "\"},";
+    }
+
+    const auto compressed = gzip::compress(data);
+    REQUIRE(compressed.size() < data.size() / 10U);
+    REQUIRE(static_cast<unsigned char>(compressed.at(0)) == 0x1fU); // gzip magic number
+    REQUIRE(static_cast<unsigned char>(compressed.at(1)) == 0x8bU);
+    REQUIRE(gzip::decompress(compressed) == data);
+
+    REQUIRE(gzip::decompress(gzip::compress("")).empty());
+    REQUIRE_THROWS(gzip::decompress(data));
+    REQUIRE_THROWS(gzip::decompress(compressed.substr(0, compressed.size() / 2U)));
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/LatencyTracker.hpp>
+
+#include <chrono>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Latency percentiles are computed per key over a sliding window", "[CapybotUtils/LatencyTracker]")
+{
+    LatencyTracker tracker(100);
+
+    REQUIRE_FALSE(tracker.getPercentile("host", 0.95).has_value()); // no samples
+
+    for (int i = 1; i <= 100; ++i)
+    {
+        tracker.record("host", std::chrono::milliseconds(i));
+    }
+    tracker.record("other host", 5ms);
+
+    REQUIRE(tracker.getPercentile("host", 0.95) == 95ms);
+    REQUIRE(tracker.getPercentile("host", 0.5) == 50ms);
+    REQUIRE(tracker.getPercentile("host", 1.0) == 100ms);
+    REQUIRE(tracker.getPercentile("other host", 0.95) == 5ms);
+    REQUIRE_FALSE(tracker.getPercentile("other host", 0.95, 10).has_value()); // not enough samples
+
+    // old samples are dropped once the window is full
+    for (int i = 0; i < 100; ++i)
+    {
+        tracker.record("host", 1ms);
+    }
+    REQUIRE(tracker.getPercentile("host", 0.95) == 1ms);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/RequestCoalescer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Concurrent identical requests share a single execution", "[CapybotUtils/RequestCoalescer]")
+{
+    RequestCoalescer<int> coalescer;
+    std::atomic_int executions{0};
+
+    const auto slowRequest = [&executions]() {
+        ++executions;
+        std::this_thread::sleep_for(100ms);
+        return 42;
+    };
+
+    constexpr int NUMBER_CALLERS{8};
+    std::vector<std::thread> callers;
+    std::atomic_int resultsSum{0};
+    for (int i = 0; i < NUMBER_CALLERS; ++i)
+    {
+        callers.emplace_back([&] { resultsSum += coalescer.execute("key", slowRequest); });
+    }
+    for (auto&& t : callers)
+    {
+        t.join();
+    }
+
+    REQUIRE(executions == 1);
+    REQUIRE(resultsSum == 42 * NUMBER_CALLERS);
+    REQUIRE(coalescer.size() == 0); // no cache
+
+    // not in flight anymore, executes again; different keys do not share executions
+    REQUIRE(coalescer.execute("key", slowRequest) == 42);
+    REQUIRE(coalescer.execute("other key", [] { return 7; }) == 7);
+    REQUIRE(executions == 2);
+}
+
+TEST_CASE("Results are cached for the configured TTL, exceptions are not", "[CapybotUtils/RequestCoalescer]")
+{
+    RequestCoalescer<int> coalescer(200ms);
+    int executions{0};
+    const auto request = [&executions]() { return ++executions; };
+
+    REQUIRE(coalescer.execute("key", request) == 1);
+    REQUIRE(coalescer.execute("key", request) == 1); // cached
+    REQUIRE(coalescer.size() == 1);
+
+    std::this_thread::sleep_for(250ms);
+    REQUIRE(coalescer.execute("key", request) == 2); // expired
+
+    const auto throwingRequest = []() -> int { throw std::runtime_error("request failed"); };
+    REQUIRE_THROWS_AS(coalescer.execute("throwing key", throwingRequest), std::runtime_error);
+    REQUIRE(coalescer.execute("throwing key", request) == 3);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/ShmRing.hpp>
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace capybot;
+
+namespace
+{
+const std::string RING_NAME{"/capybot_shm_ring_tests"};
+}
+
+TEST_CASE("Messages pushed to the ring are drained in order", "[CapybotUtils/ShmRing]")
+{
+    auto ring = ShmRing::create(RING_NAME, 4U, 16U);
+    REQUIRE(ring->getCapacity() == 4U);
+    REQUIRE(ring->getMaxMessageSize() == 16U);
+
+    auto producer = ShmRing::open(RING_NAME); // attaches to the same region
+    REQUIRE(producer->getCapacity() == 4U);
+    REQUIRE(producer->tryPush(1U, "a"));
+    REQUIRE(producer->tryPush(2U, ""));
+    REQUIRE(producer->tryPush(3U, "0123456789abcdef"));
+    REQUIRE(producer->tryPush(4U, "d"));
+    REQUIRE_FALSE(producer->tryPush(5U, "e")); // full
+    REQUIRE_THROWS_AS(producer->tryPush(5U, "0123456789abcdefg"), std::length_error);
+
+    std::vector<std::pair<uint8_t, std::string>> messages;
+    const auto drain = [&](std::size_t max) {
+        return ring->drain([&](uint8_t type, std::string_view data) { messages.emplace_back(type, data); }, max);
+    };
+    REQUIRE(drain(2U) == 2U);
+    REQUIRE(producer->tryPush(5U, "e")); // slots are reused once drained
+    REQUIRE(drain(10U) == 3U);
+    REQUIRE(drain(10U) == 0U);
+    REQUIRE(messages == std::vector<std::pair<uint8_t, std::string>>{
+                            {1U, "a"}, {2U, ""}, {3U, "0123456789abcdef"}, {4U, "d"}, {5U, "e"}});
+}
+
+TEST_CASE("The ring only exists while its owner does", "[CapybotUtils/ShmRing]")
+{
+    REQUIRE_THROWS_AS(ShmRing::create(RING_NAME, 3U, 16U), std::invalid_argument); // not a power of 2
+    {
+        auto ring = ShmRing::create(RING_NAME, 2U, 16U);
+        auto producer = ShmRing::open(RING_NAME);
+        REQUIRE(producer->tryPush(1U, "a"));
+    }
+    REQUIRE_THROWS_AS(ShmRing::open(RING_NAME), std::runtime_error);
+
+    // a new ring replaces whatever was left under its name
+    auto stale = ShmRing::create(RING_NAME, 2U, 16U);
+    REQUIRE(stale->tryPush(1U, "stale"));
+    auto ring = ShmRing::create(RING_NAME, 2U, 16U);
+    REQUIRE(ring->drain([](uint8_t, std::string_view) {}) == 0U);
+}
+
+TEST_CASE("Concurrent producers do not lose or reorder their messages", "[CapybotUtils/ShmRing]")
+{
+    constexpr uint8_t PRODUCERS{4U};
+    constexpr uint32_t MESSAGES_PER_PRODUCER{20000U};
+    auto ring = ShmRing::create(RING_NAME, 64U, 8U);
+
+    std::vector<std::thread> producers;
+    for (uint8_t producerId = 0U; producerId < PRODUCERS; ++producerId)
+    {
+        producers.emplace_back([producerId] {
+            auto producer = ShmRing::open(RING_NAME);
+            for (uint32_t i = 0U; i < MESSAGES_PER_PRODUCER;)
+            {
+                const auto message = std::to_string(i);
+                i += producer->tryPush(producerId, message) ? 1U : 0U; // retry while full
+            }
+        });
+    }
+
+    std::map<uint8_t, uint32_t> nextMessage;
+    bool isOrdered{true};
+    uint64_t count{0U};
+    while (count < PRODUCERS * MESSAGES_PER_PRODUCER)
+    {
+        count += ring->drain([&](uint8_t producerId, std::string_view data) {
+            isOrdered &= std::string(data) == std::to_string(nextMessage[producerId]++);
+        });
+    }
+    for (auto&& producer : producers)
+    {
+        producer.join();
+    }
+
+    REQUIRE(isOrdered);
+    REQUIRE(ring->drain([](uint8_t, std::string_view) {}) == 0U);
+    for (uint8_t producerId = 0U; producerId < PRODUCERS; ++producerId)
+    {
+        REQUIRE(nextMessage[producerId] == MESSAGES_PER_PRODUCER);
+    }
+}
+
+TEST_CASE("The consumer does not trust the ring shape written in shared memory", "[CapybotUtils/ShmRing]")
+{
+    auto ring = ShmRing::create(RING_NAME, 2U, 16U);
+    auto producer = ShmRing::open(RING_NAME);
+    REQUIRE(producer->tryPush(1U, "corrupted"));
+    REQUIRE(producer->tryPush(2U, "valid"));
+
+    // map the region as a misbehaving producer would
+    const int fd = ::shm_open(RING_NAME.c_str(), O_RDWR, 0);
+    REQUIRE(fd >= 0);
+    struct stat fileStat;
+    REQUIRE(::fstat(fd, &fileStat) == 0);
+    auto* region = static_cast<char*>(::mmap(nullptr, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ::close(fd);
+    REQUIRE(region != MAP_FAILED);
+
+    // header: magic, version, slot count, slot size; slot: sequence, size, type, data
+    const uint32_t hugeValue{0x40000000U};
+    std::memcpy(region + 2U * sizeof(uint32_t), &hugeValue, sizeof(hugeValue));
+    std::memcpy(region + 3U * sizeof(uint32_t), &hugeValue, sizeof(hugeValue));
+    const std::string_view payload{"corrupted"};
+    auto* data = static_cast<char*>(::memmem(region, fileStat.st_size, payload.data(), payload.size()));
+    REQUIRE(data != nullptr);
+    std::memcpy(data - 8U, &hugeValue, sizeof(hugeValue));
+
+    std::vector<std::pair<uint8_t, std::string>> messages;
+    REQUIRE(ring->drain([&](uint8_t type, std::string_view body) { messages.emplace_back(type, body); }) == 2U);
+    REQUIRE(ring->getDroppedCount() == 1U);
+    REQUIRE(messages == std::vector<std::pair<uint8_t, std::string>>{{2U, "valid"}});
+    REQUIRE(ring->getCapacity() == 2U);
+    REQUIRE(ring->getMaxMessageSize() == 16U);
+    ::munmap(region, fileStat.st_size);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2023 Eduardo Rocha
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utils/TimingWheel.hpp>
+
+#include <chrono>
+#include <vector>
+
+using namespace capybot;
+using namespace std::chrono_literals;
+
+TEST_CASE("Timers expire at their deadline, in order", "[CapybotUtils/TimingWheel]")
+{
+    const auto start = TimingWheel::Clock::now();
+    TimingWheel wheel(1ms, start);
+
+    std::vector<int> expired;
+    wheel.schedule(start + 30ms, [&expired] { expired.push_back(30); });
+    wheel.schedule(start + 10ms, [&expired] { expired.push_back(10); });
+    wheel.schedule(start + 20ms, [&expired] { expired.push_back(20); });
+    REQUIRE(wheel.size() == 3);
+
+    wheel.advance(start + 9ms);
+    REQUIRE(expired.empty());
+
+    wheel.advance(start + 20ms);
+    REQUIRE(expired == std::vector<int>{10, 20});
+
+    wheel.advance(start + 100ms);
+    REQUIRE(expired == std::vector<int>{10, 20, 30});
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("Timers beyond the first wheel levels cascade down and expire on time", "[CapybotUtils/TimingWheel]")
+{
+    const auto start = TimingWheel::Clock::now();
+    TimingWheel wheel(1ms, start);
+
+    // one per level, plus one in the overflow list (> 2^24 ticks)
+    const std::vector<std::chrono::milliseconds> delays{50ms, 3'000ms, 200'000ms, 10'000'000ms, 20'000'000ms};
+    std::vector<std::chrono::milliseconds> expired;
+    for (auto&& delay : delays)
+    {
+        wheel.schedule(start + delay, [&expired, delay] { expired.push_back(delay); });
+    }
+
+    for (auto&& delay : delays)
+    {
+        wheel.advance(start + delay - 1ms);
+        REQUIRE(expired.size() == static_cast<std::size_t>(&delay - &delays.front()));
+        wheel.advance(start + delay);
+        REQUIRE(expired.back() == delay);
+    }
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("Timers can be cancelled and scheduled from callbacks", "[CapybotUtils/TimingWheel]")
+{
+    const auto start = TimingWheel::Clock::now();
+    TimingWheel wheel(1ms, start);
+
+    int counter = 0;
+    const auto id = wheel.schedule(start + 10ms, [&counter] { counter += 100; });
+    wheel.schedule(start + 5ms, [&] { wheel.schedule(start + 15ms, [&counter] { ++counter; }); });
+
+    REQUIRE(wheel.cancel(id));
+    REQUIRE_FALSE(wheel.cancel(id));                              // already cancelled
+    REQUIRE_FALSE(wheel.cancel(TimingWheel::INVALID_TIMER_ID)); // never scheduled
+
+    wheel.advance(start + 10ms);
+    REQUIRE(counter == 0);
+    REQUIRE(wheel.size() == 1);
+
+    wheel.advance(start + 15ms);
+    REQUIRE(counter == 1);
+
+    // deadlines in the past expire on the next advance
+    wheel.schedule(start, [&counter] { ++counter; });
+    wheel.advance(start + 16ms);
+    REQUIRE(counter == 2);
+}
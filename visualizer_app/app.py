@@ -16,6 +16,7 @@
 
 import requests
 import argparse
+import json
 import time
 
 
@@ -32,9 +33,12 @@ def parse_cli_args():
     return parser.parse_args()
 
 
-def get_json_from_http_request(req_url):
-    response = requests.get(req_url)
-    return response.json()
+def stream_marking_updates(req_url):
+    """Yield the `data` of each server-sent event; the server only sends places that changed."""
+    with requests.get(req_url, stream=True) as response:
+        for line in response.iter_lines(decode_unicode=True):
+            if line and line.startswith("data: "):
+                yield json.loads(line[len("data: "):])
 
 
 def render_marking(marking):
@@ -43,9 +47,16 @@ def render_marking(marking):
 
 if __name__ == "__main__":
     cli_args = parse_cli_args()
-    req_url = "http://" + cli_args.bnet_host + ':' + cli_args.bnet_port + "/get_marking"
+    req_url = "http://" + cli_args.bnet_host + ':' + cli_args.bnet_port + "/marking_stream"
 
+    marking = {}
     while True:
-        marking = get_json_from_http_request(req_url)
-        render_marking(marking)
-        time.sleep(3)
+        try:
+            for update in stream_marking_updates(req_url):
+                if update["full"]:
+                    marking = {}
+                marking.update(update["marking"])
+                render_marking(marking)
+        except requests.exceptions.RequestException as e:
+            print("Stream interrupted, reconnecting: " + str(e))
+            time.sleep(3)